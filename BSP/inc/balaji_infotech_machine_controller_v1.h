@@ -55,6 +55,11 @@
  #define CONFIG_SSR2_GPIO 23
  #endif
 
+ /* MDR die position index (one pulse per oscillation, strain reference for S'/S''), -1 = not fitted */
+ #ifndef CONFIG_MDR_REF_GPIO
+ #define CONFIG_MDR_REF_GPIO -1
+ #endif
+
  /* Exported handles */
  extern spi_device_handle_t g_rtd_spi;
  extern i2c_master_bus_handle_t g_i2c_bus;
@@ -20,13 +20,42 @@ void CommTask_Start(void);
    {"cmd":"rtd_calib","dev":1,"known":100.0}
    {"cmd":"set_temp","value":180}  // Sets temperature for both RTDs
    {"cmd":"set_temp_rtd","dev":1,"temp":180}  // Sets temperature for individual RTD (dev: 1-2)
-   {"cmd":"set_mode","value":"run|idle|stop|calib"}
+   {"cmd":"set_mode","value":"run|idle|stop|calib|sweep"}  // sweep needs a plan from set_sweep
    {"cmd":"set_run_time","seconds":120}
    {"cmd":"calibrate_mdr","weight":2.0,"lever":0.12}
    {"cmd":"offset_mdr","ms":5000}
-   {"cmd":"tare_idle_amp"}  // Tares/offsets idle mode amplitude with current value
+   {"cmd":"tare_idle_amp"}  // Tares/offsets idle mode amplitude with the current live (one-period) amplitude
    {"cmd":"set_relay","relay":1,"state":1}  // relay: 1-4, state: 0=OFF, 1=ON
    {"cmd":"get_relays"}  // Returns current state of all 4 relays
+   {"cmd":"set_loadcell_gain","gain":128}  // channel A gain: 128 or 64; single HX711 only (not_supported with CONFIG_HX711_DEVICES > 1)
+   {"cmd":"set_loadcell_mux","ratio_a":10,"ratio_b":1}  // interleave channel B (gain 32); ratio_a 0 = off; single HX711 only
+   {"cmd":"get_loadcell_b"}  // Returns the last settled channel B raw value
+   {"cmd":"get_loadcells"}  // raw and weight of every HX711 on the shared clock
+   {"cmd":"set_loadcell_cal","ch":1,"offset":8388608,"coef":200.0}  // per-channel zero and scale
+   {"cmd":"tare_loadcell","ch":1}  // zero one channel from its next 10 samples
+   {"cmd":"get_loadcell_stats","reset":0}  // measured SPS, samples per cycle; interval/latency as [n,min,mean,max,std] us, queue_overruns
+   {"cmd":"set_filter","target":"raw","spec":"hampel:7:3,ma:10"}  // target: raw, run_amp, idle_amp; omit spec to query
+       // spec stages (comma separated, max 4): ma:N, median:N, hampel:N[:K], iir:ALPHA, or none; N at most 32
+       // a rejected spec replies {"ok":false,"err":"bad_filter_spec","max_stages":4,"max_samples":256,"max_rank_window":64}
+       // (ma/median/hampel windows of one target share max_samples; median/hampel at most max_rank_window)
+   {"cmd":"set_window","target":"run","cycles":4}  // target: run, idle; oscillation cycles per reported amplitude (1-32)
+   {"cmd":"set_peak","target":"run","mode":"sine"}  // cycle min/max: sample (default), parabola or sine through the extreme and its neighbours; for low SPS
+   {"cmd":"set_telemetry","format":"binary"}  // binary: COBS/CRC16 frames (see telemetry.h), every conversion sent; json (default): text lines
+   {"cmd":"get_tx_stats","reset":1}  // output lanes (response, event, bulk; strict priority): records queued, dropped (newest/oldest, bytes), high water; reset optional
+   {"cmd":"get_stack"}  // least free stack (bytes) seen by CommTask and ModeTask since start
+   {"cmd":"set_tx_policy","lane":"bulk","policy":"drop_oldest"}  // when a lane is full: drop_newest (default) rejects new lines, drop_oldest discards queued ones; lane defaults to bulk
+   {"cmd":"set_plateau","slope":0.01,"window_s":60}  // end the run once |dTorque/dt| < slope N·m/min over window_s (after ts2); slope 0 = off; next run
+   {"cmd":"set_phase_ref","deg":12.5}  // strain reference phase offset for S'/S''/tan delta; omit deg to zero on the last cycle
+       // run/sweep records carry phase_deg, s_prime, s_dprime, tan_delta only with the die index ("ref":"index"); with "ref":"torque" they are null
+   {"cmd":"set_sweep","freqs":[0.5,1.0,1.66,3.33],"dwell_s":30}  // sweep plan (max 16 steps, 0.5-10 Hz); dwell_s one value or one per step
+       // each frequency must also lie within SPS/160 .. SPS/8 at the measured SPS, else {"ok":false,"err":"freq_vs_sps","freq_hz":f,"sps":s,"min_hz":a,"max_hz":b}
+       // each step starts with {"mode":"sweep","step":i,"freq_hz":f,...}: set the drive to f; the dwell is timed on the conversion timestamps and its second half is averaged into {"point":i,...}
+       // point phase_deg, s_prime, s_dprime and tan_delta need the die index ("ref":"index"); without it ("ref":"torque") they are null
+
+   One JSON object per line; keys other than "cmd" must be those listed for the command.
+   Errors: {"ok":false,"err":"bad_json","at":<byte offset>}, {"ok":false,"err":"unknown_cmd"},
+           {"ok":false,"err":"bad_args","arg":"<key>"} for a missing, unknown, mistyped or out-of-range argument,
+           {"ok":false,"err":"not_supported"} for a command this build's hardware configuration cannot carry out
 */
 
 #endif /* COMM_EXEC_H */
\ No newline at end of file
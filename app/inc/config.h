@@ -5,7 +5,9 @@
 #include <stdint.h>
 
 /* Global function declarations */
-extern void UART_Printf(const char *format, ...);
+extern void UART_Printf(const char *format, ...);   // events and messages
+extern void UART_Reply(const char *format, ...);    // command responses, highest priority
+extern void UART_Stream(const char *format, ...);   // bulk telemetry, lowest priority
 extern uint8_t mode;
 extern uint32_t offTime;
 extern uint8_t triggerFlg;
@@ -0,0 +1,39 @@
+#ifndef CURE_CURVE_H
+#define CURE_CURVE_H
+
+#include <stdint.h>
+
+#define CURE_ENVELOPE_POINTS  128     // rise from ML kept for t10..t90 (decimated when full)
+#define CURE_TS1_NM           0.1     // scorch ts1: ML + 1 dN·m
+#define CURE_TS2_NM           0.2     // scorch ts2: ML + 2 dN·m
+
+/* Exported types */
+typedef struct {
+    float t_s;
+    float torque;
+} cure_point_t;
+
+typedef struct {
+    double ml;                    // minimum torque so far
+    float t_ml;
+    double mh;                    // maximum torque since ML
+    float t_mh;
+    cure_point_t env[CURE_ENVELOPE_POINTS];   // running maximum since ML, monotone
+    uint16_t n;
+    uint32_t points;              // values fed since reset
+} cure_curve_t;
+
+typedef struct {
+    double ml, mh;
+    float t_ml, t_mh;
+    float ts1, ts2;               // seconds from run start, -1 if not reached
+    float t10, t50, t90;
+} cure_result_t;
+
+/* Exported functions */
+void cure_curve_reset(cure_curve_t *cc);
+void cure_curve_add(cure_curve_t *cc, float t_s, double torque);
+void cure_curve_result(const cure_curve_t *cc, cure_result_t *res);
+float cure_curve_time_at(const cure_curve_t *cc, double torque);
+
+#endif /* CURE_CURVE_H */
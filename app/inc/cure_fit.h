@@ -0,0 +1,52 @@
+#ifndef CURE_FIT_H
+#define CURE_FIT_H
+
+#include <stdint.h>
+
+#define CURE_FIT_LAG_S      30.0f     // L: T(t) is regressed on T(t - L)
+#define CURE_FIT_HISTORY    128       // cycles kept to look back L seconds
+#define CURE_FIT_MIN_POINTS 10
+#define CURE_FIT_RHO_MAX    0.95      // cap on the residual autocorrelation used to widen the bounds
+
+/* Exported types */
+typedef struct {
+    uint8_t started;
+    float hist_t[CURE_FIT_HISTORY];
+    float hist_y[CURE_FIT_HISTORY];
+    uint16_t head;
+    uint16_t count;
+
+    uint32_t n;                   // regression pairs
+    double ref;                   // subtracted from both sides for conditioning
+    double sx, sy, sxx, sxy, syy;
+    double sxx1, sxy1, syx1, syy1; // products with the previous pair, for the residual autocorrelation
+    double x1, y1, xp, yp;        // first and previous pair
+    float last_t;
+    double last_y;
+} cure_fit_t;
+
+/*
+  *_ci_lo/hi are approximate 95 % confidence bounds: +-2 standard errors
+  with the residual variance widened by (1 + rho) / (1 - rho), rho the
+  lag-1 autocorrelation of the regression residuals. That is the effective
+  sample size n (1 - rho) / (1 + rho) of AR(1) errors; consecutive cycles
+  share the amplitude smoothing, so plain OLS errors would be far too
+  narrow. The noise in the regressor T(t - L) is not accounted for: near
+  the start of the rise the bounds can still be optimistic.
+*/
+typedef struct {
+    double mh, mh_ci_lo, mh_ci_hi;        // predicted MH and bounds
+    double k, k_ci_lo, k_ci_hi;           // rate constant (1/s)
+    float t90, t90_ci_lo, t90_ci_hi;      // predicted t90 (s from run start) and bounds
+    double rho;                   // lag-1 residual autocorrelation used (0 .. CURE_FIT_RHO_MAX)
+    double rms;                   // regression residual
+    uint32_t points;
+} cure_fit_result_t;
+
+/* Exported functions */
+void cure_fit_reset(cure_fit_t *cf);
+void cure_fit_start(cure_fit_t *cf);
+void cure_fit_add(cure_fit_t *cf, float t_s, double torque);
+uint8_t cure_fit_solve(const cure_fit_t *cf, double ml, cure_fit_result_t *res);
+
+#endif /* CURE_FIT_H */
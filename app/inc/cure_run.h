@@ -0,0 +1,23 @@
+#ifndef CURE_RUN_H
+#define CURE_RUN_H
+
+#include <stdint.h>
+#include "cure_curve.h"
+#include "cure_fit.h"
+#include "plateau.h"
+
+/* Exported types */
+// Cure analytics of one run, fed one filtered cycle amplitude at a time
+typedef struct {
+    cure_curve_t curve;           // ML, MH, scorch and cure times
+    cure_fit_t fit;               // first-order model, from ts2 on
+    plateau_t plateau;            // optional early end
+    float end_s;                  // plateau detected at (s from run start), -1 until then
+} cure_run_t;
+
+/* Exported functions */
+void cure_run_start(cure_run_t *run, float slope_per_min, float window_s);
+uint8_t cure_run_add(cure_run_t *run, float t_s, double torque, cure_fit_result_t *fit);
+uint8_t cure_run_past_ts2(const cure_run_t *run);
+
+#endif /* CURE_RUN_H */
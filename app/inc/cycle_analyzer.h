@@ -0,0 +1,83 @@
+#ifndef CYCLE_ANALYZER_H
+#define CYCLE_ANALYZER_H
+
+#include <stdint.h>
+#include "cycle_tracker.h"
+#include "filter_chain.h"
+#include "lockin.h"
+#include "sdft.h"
+
+#define CYCLE_ANALYZER_MAX_WINDOW   32        // cycles per analysis window
+#define CYCLE_ANALYZER_SAMPLE_HZ    80.0f     // sample rate assumed until measured
+
+/* Exported types */
+// Strain reference for the quadrature fit; 0 = unavailable, fit against the tracked cycle
+typedef uint8_t (*cycle_ref_cb_t)(int64_t *ref_us, int64_t *period_us);
+
+typedef struct {
+    float nominal_hz;             // expected oscillation frequency
+    uint8_t window_cycles;        // cycles combined into one result (1 = every cycle)
+    filter_spec_t smoothing;      // applied to the window amplitudes
+    cycle_peak_mode_t peak_mode;  // how cycle min/max are estimated
+    uint8_t quadrature;           // per-cycle lock-in (S', S'', tan delta) and harmonics
+    cycle_ref_cb_t ref;           // strain reference for the lock-in, NULL = tracked cycle
+} cycle_analyzer_config_t;
+
+// One analysis window
+typedef struct {
+    int64_t start_us;             // start of the first cycle
+    int64_t period_us;            // span of the window
+    double freq_hz;               // measured frequency at the end of the window
+    uint8_t locked;               // every cycle bounded by crossings
+    uint8_t cycles;
+    double amp;                   // mean per-cycle (max - min) / 2
+    double amp_filtered;          // amp after the smoothing chain
+    double min;                   // extremes over the window
+    double max;
+    int64_t t_min_us;             // when they occurred
+    int64_t t_max_us;
+
+    uint8_t has_quad;             // quad holds the mean of the per-cycle fits
+    uint8_t quad_ref;             // 1: external strain reference, 0: tracked cycle
+    lockin_result_t quad;         // phase offset applied
+    uint8_t has_harm;             // harm is averaged over locked cycles
+    lockin_harmonics_t harm;
+} cycle_window_t;
+
+typedef struct {
+    cycle_analyzer_config_t cfg;
+    float phase_offset_deg;       // die angle of the strain reference
+    double last_phase_deg;        // last fitted phase before the offset
+
+    cycle_tracker_t tracker;
+    filter_chain_t amp_filter;
+    sdft_t sdft;                  // sample-by-sample amplitude over one period
+    lockin_t lockin;              // samples of the cycle in progress
+
+    double interval_us;           // smoothed sample interval
+    int64_t prev_us;
+
+    // Window in progress
+    uint8_t cycles;
+    uint8_t all_locked;
+    int64_t start_us;
+    double amp_sum, min, max;
+    int64_t t_min_us, t_max_us;
+    uint8_t quad_n, quad_ref;
+    double sp_sum, sdp_sum, mean_sum;
+    uint8_t harm_n;
+    double rms2_sum, mag_sum[LOCKIN_HARMONICS];
+} cycle_analyzer_t;
+
+/* Exported functions */
+void cycle_analyzer_init(cycle_analyzer_t *ca, const cycle_analyzer_config_t *cfg);
+void cycle_analyzer_reset(cycle_analyzer_t *ca);
+void cycle_analyzer_set_window(cycle_analyzer_t *ca, uint8_t window_cycles);
+void cycle_analyzer_set_nominal(cycle_analyzer_t *ca, float nominal_hz);
+void cycle_analyzer_set_peak_mode(cycle_analyzer_t *ca, cycle_peak_mode_t mode);
+uint8_t cycle_analyzer_feed(cycle_analyzer_t *ca, int64_t t_us, double x, cycle_window_t *out);
+double cycle_analyzer_amp(const cycle_analyzer_t *ca);
+double cycle_analyzer_live(const cycle_analyzer_t *ca);
+filter_chain_t *cycle_analyzer_filter(cycle_analyzer_t *ca);
+
+#endif /* CYCLE_ANALYZER_H */
@@ -0,0 +1,71 @@
+#ifndef CYCLE_TRACKER_H
+#define CYCLE_TRACKER_H
+
+#include <stdint.h>
+
+#define CYCLE_HYSTERESIS    0.25    // re-arm below centre - 0.25 * amplitude
+#define CYCLE_MIN_PERIOD    0.5     // shortest accepted cycle, in nominal periods
+#define CYCLE_TIMEOUT       1.5     // nominal periods without a crossing before a locked tracker gives up
+#define CYCLE_FREQ_ALPHA    0.25    // smoothing of the measured period
+
+/* Exported types */
+typedef enum {
+    CYCLE_PEAK_SAMPLE = 0,        // largest/smallest sample
+    CYCLE_PEAK_PARABOLA,          // vertex of the parabola through the extreme and its neighbours
+    CYCLE_PEAK_SINE,              // crest of the sinusoid at the tracked frequency through them
+} cycle_peak_mode_t;
+
+typedef struct {
+    int64_t start_us;             // cycle start (interpolated upward crossing when locked)
+    int64_t period_us;
+    double freq_hz;               // smoothed measured frequency, nominal until locked
+    double amp;                   // (max - min) / 2
+    double min;
+    double max;
+    int64_t t_min_us;             // when min/max occurred (interpolated with the peak mode)
+    int64_t t_max_us;
+    uint32_t samples;
+    uint8_t locked;               // bounded by two crossings rather than the timeout
+} cycle_result_t;
+
+// An extreme sample with its neighbours, for sub-sample interpolation
+typedef struct {
+    int64_t t_us[3];              // before, at, after
+    double x[3];
+    uint8_t have_before;
+    uint8_t have_after;
+} cycle_peak_t;
+
+typedef struct {
+    float nominal_hz;
+    cycle_peak_mode_t peak_mode;
+
+    int64_t start_us;
+    uint8_t started;
+    uint8_t synced;               // start_us is a real crossing
+    int8_t state;                 // -1: armed below centre, +1: crossed, waiting to re-arm
+    int64_t prev_us;
+    double prev_d;
+    double prev_x;
+    uint8_t has_prev_x;
+
+    double cur_min;
+    double cur_max;
+    uint32_t cur_n;
+    cycle_peak_t pk_min;
+    cycle_peak_t pk_max;
+
+    uint8_t has_prev;             // centre/amp from a completed cycle
+    double centre;
+    double amp;
+    double period_us;             // smoothed measured period, 0 until locked
+} cycle_tracker_t;
+
+/* Exported functions */
+void cycle_tracker_init(cycle_tracker_t *ct, float nominal_hz);
+void cycle_tracker_reset(cycle_tracker_t *ct);
+uint8_t cycle_tracker_feed(cycle_tracker_t *ct, int64_t t_us, double x, cycle_result_t *out);
+double cycle_tracker_freq(const cycle_tracker_t *ct);
+void cycle_tracker_set_peak_mode(cycle_tracker_t *ct, cycle_peak_mode_t mode);
+
+#endif /* CYCLE_TRACKER_H */
@@ -0,0 +1,65 @@
+#ifndef FILTER_CHAIN_H
+#define FILTER_CHAIN_H
+
+#include <stdint.h>
+
+#define FILTER_MAX_STAGES   4
+#define FILTER_POOL_SAMPLES 256   // history of all ma/median/hampel stages of a chain together:
+                                  // 3.2 s of raw conversions at 80 SPS, 256 cycles of amplitudes
+#define FILTER_MAX_RANK     64    // longest median/hampel window: it is sorted every sample
+#define FILTER_SPEC_LEN     64    // longest text spec accepted/produced
+
+/* Exported types */
+typedef enum {
+    FILTER_NONE = 0,
+    FILTER_MA,                    // moving average (running sum, O(1) per sample, no re-summing)
+    FILTER_HAMPEL,                // median/MAD spike rejector; k = 0 is a plain median
+    FILTER_IIR,                   // first order low-pass: y += alpha * (x - y)
+} filter_type_t;
+
+typedef struct {
+    filter_type_t type;
+    uint16_t window;              // MA / Hampel window length
+    float param;                  // Hampel threshold k (sigmas) or IIR alpha
+} filter_spec_t;
+
+typedef struct {
+    filter_spec_t spec;
+    uint16_t offset;              // history: spec.window samples from pool[offset]
+    uint16_t index;
+    uint16_t count;
+    int64_t isum;                 // MA running sum, integer input (exact)
+    double sum, comp;             // MA running sum and its compensation, other input
+    double y;                     // IIR state
+} filter_stage_t;
+
+typedef struct {
+    filter_stage_t stage[FILTER_MAX_STAGES];
+    uint8_t stages;
+    uint8_t integer_input;        // samples are whole numbers (raw conversions)
+    double out;                   // last output
+    uint8_t has_out;
+    double pool[FILTER_POOL_SAMPLES];
+    double scratch[FILTER_MAX_RANK];   // median/hampel sort buffer
+
+    // Reconfiguration from another task: written by filter_chain_request(),
+    // picked up by the owner's next filter_chain_apply()/filter_chain_reset()
+    filter_spec_t pending[FILTER_MAX_STAGES];
+    uint8_t pending_stages;
+    volatile uint32_t pending_seq;  // odd while the writer is updating pending[]
+    uint32_t applied_seq;
+} filter_chain_t;
+
+/* Exported functions */
+void filter_chain_init(filter_chain_t *chain, const filter_spec_t *spec, uint8_t stages);
+void filter_chain_set_integer(filter_chain_t *chain);
+void filter_chain_reset(filter_chain_t *chain);
+double filter_chain_apply(filter_chain_t *chain, double x);
+double filter_chain_output(const filter_chain_t *chain);
+int filter_chain_request(filter_chain_t *chain, const char *text);
+int filter_chain_describe(const filter_chain_t *chain, char *out, int out_sz);
+int filter_spec_parse(const char *text, filter_spec_t *spec, uint8_t max_stages);
+uint8_t filter_spec_fits(const filter_spec_t *spec, uint8_t stages);
+int filter_spec_format(const filter_spec_t *spec, uint8_t stages, char *out, int out_sz);
+
+#endif /* FILTER_CHAIN_H */
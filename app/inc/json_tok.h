@@ -0,0 +1,57 @@
+#ifndef JSON_TOK_H
+#define JSON_TOK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define JSON_MAX_MEMBERS    12      // keys in the object
+#define JSON_MAX_ELEMENTS   32      // array elements, all arrays together
+
+/* Exported types */
+typedef enum {
+    JSON_STRING = 0,
+    JSON_NUMBER,
+    JSON_TRUE,
+    JSON_FALSE,
+    JSON_NULL,
+    JSON_ARRAY,                   // of scalars
+} json_type_t;
+
+typedef enum {
+    JSON_OK = 0,
+    JSON_ERR_SYNTAX = -1,         // not valid JSON
+    JSON_ERR_UNSUPPORTED = -2,    // valid, but nested deeper than an array of scalars
+    JSON_ERR_LIMIT = -3,          // more members or elements than the document holds
+    JSON_ERR_DUPLICATE = -4,      // a key given twice
+} json_err_t;
+
+// Values point into the parsed text, which must outlive the document
+typedef struct {
+    json_type_t type;
+    uint8_t escaped;              // string holds backslash escapes (left undecoded)
+    uint8_t first;                // array: index of its first element in json_doc_t.elem
+    uint16_t len;                 // string: bytes between the quotes; array: element count
+    const char *str;              // string: first byte after the opening quote
+    double num;                   // number
+} json_value_t;
+
+typedef struct {
+    const char *key;              // first byte after the opening quote
+    uint16_t key_len;
+    json_value_t val;
+} json_member_t;
+
+// One flat JSON object, e.g. a command line
+typedef struct {
+    json_member_t member[JSON_MAX_MEMBERS];
+    uint8_t members;
+    json_value_t elem[JSON_MAX_ELEMENTS];
+    uint8_t elems;
+    uint16_t err_pos;             // offset of the offending byte when parsing failed
+} json_doc_t;
+
+/* Exported functions */
+json_err_t json_parse(json_doc_t *doc, const char *text, size_t len);
+const json_value_t *json_get(const json_doc_t *doc, const char *key);
+
+#endif /* JSON_TOK_H */
@@ -6,20 +6,69 @@
 #include "freertos/task.h"
 #include "config.h"
 #include "hx711Config.h"
+#include "filter_chain.h"
+
+#define LOADCELL_CHANNELS   CONFIG_HX711_DEVICES
+#define LOADCELL_QUEUE_LEN  64    // samples buffered for the consumer, power of two
 
 /* Exported types */
+typedef struct {
+    int32_t offset;               // raw value at zero load
+    float coef;                   // raw counts per unit weight
+    int32_t last_raw;
+    float weight;
+    
+    // Pending tare: average of the next tare_samples readings becomes offset
+    uint16_t tare_samples;
+    uint16_t tare_count;
+    int64_t tare_sum;
+} LoadCell_Channel_t;
+
+// One channel A conversion as delivered to the consumer queue
+typedef struct {
+    int32_t raw;
+    int32_t filtered;
+    float weight;
+    int64_t timestamp_us;         // esp_timer time the conversion became ready
+    uint32_t seq;                 // driver conversion counter
+} LoadCell_Sample_t;
+
 typedef struct {
     hx711_t hx711;
+#if LOADCELL_CHANNELS > 1
+    hx711_multi_t multi;          // devices sharing PD_SCK; channel 0 feeds the MDR pipeline
+#endif
+    LoadCell_Channel_t channel[LOADCELL_CHANNELS];
     float current_weight;
     float tare_weight;
     float calibration_factor;
-    int32_t last_raw;
+    int32_t last_raw;             // load cell task working copies; other tasks use the snapshot
     int32_t last_raw_filtered;
+    int64_t last_timestamp_us;
+    uint32_t last_seq;
+    
+    // Latest conversion for LoadCell_GetSnapshot(), guarded by a sequence lock
+    LoadCell_Sample_t snapshot;
+    uint32_t snapshot_seq;        // odd while the load cell task is rewriting snapshot
+    
+    // Filter chain producing last_raw_filtered (10-sample moving average by default)
+    filter_chain_t raw_filter;
+    
+    // Channel A/B multiplexing (channel B is a second transducer at gain 32)
+    hx711_gain_t gain_a;          // channel A gain: HX711_GAIN_A_128 or HX711_GAIN_A_64
+    uint16_t mux_ratio_a;         // settled channel A samples per visit, 0 = channel B off
+    uint16_t mux_ratio_b;         // settled channel B samples per visit
+    hx711_gain_t mux_cur;         // channel of the last sample read
+    hx711_gain_t mux_next;        // channel programmed for the conversion in flight
+    uint16_t mux_valid;           // settled samples taken on mux_cur this visit
+    int32_t last_raw_b;
+    int64_t last_timestamp_b_us;
     
-    // Moving average filter for raw values
-    int32_t filter_buffer[10];
-    int filter_index;
-    int filter_count;
+    // Single-producer (load cell task) / single-consumer (ModeTask) sample queue
+    LoadCell_Sample_t queue[LOADCELL_QUEUE_LEN];
+    uint32_t queue_head;          // written by the producer only
+    uint32_t queue_tail;          // written by the consumer only
+    uint32_t queue_overruns;      // samples dropped because the queue was full
 } LoadCell_Handle_t;
 
 /* Exported functions */
@@ -29,5 +78,22 @@ void LoadCell_Tare(void);
 void LoadCell_Calibrate(float known_weight);
 int32_t LoadCell_GetRaw(void);
 int32_t LoadCell_GetRawFiltered(void);
+int64_t LoadCell_GetTimestamp(void);
+uint32_t LoadCell_GetSequence(void);
+void LoadCell_GetSnapshot(LoadCell_Sample_t *snapshot);
+uint8_t LoadCell_SetGain(hx711_gain_t gain_a);
+uint8_t LoadCell_SetChannelMux(uint16_t ratio_a, uint16_t ratio_b);
+int32_t LoadCell_GetRawB(void);
+uint8_t LoadCell_GetChannelCount(void);
+int32_t LoadCell_GetChannelRaw(uint8_t ch);
+float LoadCell_GetChannelWeight(uint8_t ch);
+void LoadCell_SetChannelCal(uint8_t ch, int32_t offset, float coef);
+void LoadCell_TareChannel(uint8_t ch);
+void LoadCell_GetStats(hx711_stat_t *interval, hx711_stat_t *latency);
+void LoadCell_ResetStats(void);
+filter_chain_t *LoadCell_GetRawFilter(void);
+uint8_t LoadCell_PopSample(LoadCell_Sample_t *sample);
+void LoadCell_FlushSamples(void);
+uint32_t LoadCell_GetQueueOverruns(void);
 
 #endif /* LOAD_CELL_SVC_H */
@@ -0,0 +1,40 @@
+#ifndef LOCKIN_H
+#define LOCKIN_H
+
+#include <stdint.h>
+
+#define LOCKIN_MAX_SAMPLES  160   // one cycle plus margin at 80 SPS and 1.66 Hz
+#define LOCKIN_HARMONICS    5     // harmonics analysed per cycle (fundamental included)
+
+/* Exported types */
+typedef struct {
+    int64_t t0_us;                // time of the first sample
+    int32_t dt_us[LOCKIN_MAX_SAMPLES];
+    float x[LOCKIN_MAX_SAMPLES];
+    uint16_t n;
+} lockin_t;
+
+typedef struct {
+    double amp;                   // fundamental amplitude
+    double phase_deg;             // delta: torque leads the strain reference by this
+    double s_prime;               // elastic torque S' = amp * cos(delta)
+    double s_dprime;              // viscous torque S'' = amp * sin(delta)
+    double tan_delta;             // S'' / S'
+    double mean;                  // DC level over the cycle
+    uint16_t samples;
+} lockin_result_t;
+
+typedef struct {
+    double rms;                   // sqrt(mean(x^2)) over the cycle
+    double mag[LOCKIN_HARMONICS]; // amplitude of harmonic h + 1 (mag[0] = fundamental)
+    double thd;                   // sqrt(sum mag[1..]^2) / mag[0]
+    uint16_t samples;
+} lockin_harmonics_t;
+
+/* Exported functions */
+void lockin_reset(lockin_t *li);
+void lockin_add(lockin_t *li, int64_t t_us, double x);
+uint8_t lockin_solve(const lockin_t *li, int64_t ref_us, double ref_period_us, double phase_offset_deg, lockin_result_t *out);
+uint8_t lockin_harmonics(const lockin_t *li, double period_us, lockin_harmonics_t *out);
+
+#endif /* LOCKIN_H */
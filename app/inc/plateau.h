@@ -0,0 +1,27 @@
+#ifndef PLATEAU_H
+#define PLATEAU_H
+
+#include <stdint.h>
+
+#define PLATEAU_MAX_POINTS  512   // cycles held for the slope window (~300 s at 1.66 Hz)
+
+/* Exported types */
+typedef struct {
+    float slope_per_min;          // plateau when |dT/dt| stays below this (N·m/min), 0 = off
+    float window_s;               // ... over this long
+
+    float t[PLATEAU_MAX_POINTS];
+    float y[PLATEAU_MAX_POINTS];
+    uint16_t head;                // next slot
+    uint16_t count;
+    double st, sy, stt, sty;      // regression sums, t relative to t_ref
+    float t_ref;
+} plateau_t;
+
+/* Exported functions */
+void plateau_config(plateau_t *pl, float slope_per_min, float window_s);
+void plateau_reset(plateau_t *pl);
+uint8_t plateau_add(plateau_t *pl, float t_s, double torque);
+double plateau_slope(const plateau_t *pl);
+
+#endif /* PLATEAU_H */
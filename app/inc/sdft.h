@@ -0,0 +1,27 @@
+#ifndef SDFT_H
+#define SDFT_H
+
+#include <stdint.h>
+
+#define SDFT_MAX_WINDOW     256   // samples per cycle: 0.31 Hz at 80 SPS
+
+/* Exported types */
+typedef struct {
+    uint16_t n;                   // window = one oscillation period, in samples
+    float x[SDFT_MAX_WINDOW];     // last n samples, slot m = sample index mod n
+    float wr[SDFT_MAX_WINDOW];    // twiddles e^(-j 2 pi m / n), computed by sdft_init/retune()
+    float wi[SDFT_MAX_WINDOW];
+    uint16_t index;
+    uint16_t count;
+    double sr, si;                // bin 1 of the window (sliding)
+    double fr, fi;                // bin 1 summed afresh over the current lap of the slots
+} sdft_t;
+
+/* Exported functions */
+uint8_t sdft_init(sdft_t *sd, uint16_t window);
+uint8_t sdft_retune(sdft_t *sd, uint16_t window);
+void sdft_reset(sdft_t *sd);
+double sdft_update(sdft_t *sd, double x);
+double sdft_amplitude(const sdft_t *sd);
+
+#endif /* SDFT_H */
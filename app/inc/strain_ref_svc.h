@@ -0,0 +1,10 @@
+#ifndef STRAIN_REF_SVC_H
+#define STRAIN_REF_SVC_H
+
+#include <stdint.h>
+
+/* Exported functions */
+void StrainRef_Init(void);
+uint8_t StrainRef_Get(int64_t *index_us, int64_t *period_us);
+
+#endif /* STRAIN_REF_SVC_H */
@@ -0,0 +1,56 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+#include "cycle_analyzer.h"
+
+#define SWEEP_MAX_STEPS         16
+#define SWEEP_MIN_HZ            0.5f    // one cycle fits the lock-in buffer at 80 SPS
+#define SWEEP_MAX_HZ            10.0f   // 8 samples per cycle at 80 SPS
+#define SWEEP_SETTLE_FRACTION   0.5f    // first part of each dwell is discarded as settling
+#define SWEEP_MIN_SAMPLES_CYCLE 8       // conversions per cycle at the highest frequency
+
+/* Exported types */
+typedef struct {
+    float freq_hz;                // oscillation frequency of the step
+    float dwell_s;                // time spent at it
+} sweep_step_t;
+
+/*
+  Settled result of one step. Phase, S', S'' and tan delta are only
+  defined against the die position index (CONFIG_MDR_REF_GPIO): with the
+  torque's own zero crossing as reference the phase is zero by
+  construction. Without an index they are left 0 and ref_index is 0.
+*/
+typedef struct {
+    float freq_hz;                // set frequency
+    double freq_meas;             // mean measured frequency
+    double amp;                   // mean fundamental amplitude
+    double phase_deg;             // valid if ref_index
+    double s_prime;               // valid if ref_index
+    double s_dprime;              // valid if ref_index
+    double tan_delta;             // valid if ref_index
+    uint16_t cycles;              // settled cycles averaged, 0 = no lock
+    uint8_t ref_index;            // phase/S'/S''/tan delta from index-referenced cycles
+} sweep_point_t;
+
+typedef struct {
+    sweep_step_t step[SWEEP_MAX_STEPS];
+    uint8_t steps;
+
+    uint8_t index;                // step in progress, == steps when finished
+    float step_t0;                // start of that step (s)
+    uint16_t n, n_ref;
+    double amp, sp, sdp, freq;
+    sweep_point_t table[SWEEP_MAX_STEPS];
+} sweep_t;
+
+/* Exported functions */
+void sweep_start(sweep_t *sw, const sweep_step_t *step, uint8_t steps, float t_s);
+void sweep_add(sweep_t *sw, float t_s, const cycle_window_t *w);
+int sweep_poll(sweep_t *sw, float t_s);
+uint8_t sweep_done(const sweep_t *sw);
+const sweep_step_t *sweep_current(const sweep_t *sw);
+void sweep_freq_range(double sps, float *min_hz, float *max_hz);
+
+#endif /* SWEEP_H */
@@ -0,0 +1,91 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "uart_tx_svc.h"
+
+/* Binary framing (set_telemetry "binary"):
+     frame   = COBS(type, seq, payload..., crc16_lo, crc16_hi) 0x00
+     crc16   = CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) over type, seq and payload
+     seq     = frame counter (wraps); text frames are sent ahead of queued
+               sample/cycle/fit frames, so a seq never received is a lost frame,
+               a late one is not
+   All multi-byte fields are little-endian, floats IEEE-754 single precision.
+   A receiver splits on 0x00, COBS-decodes and drops frames whose CRC fails,
+   so stray console output between frames only costs the frames it hits. */
+
+#define TELEMETRY_TEXT_MAX      512     // longest text frame payload
+
+/* Exported types */
+typedef enum {
+    TELEMETRY_JSON = 0,           // text lines (default)
+    TELEMETRY_BINARY,             // COBS/CRC16 frames
+} telemetry_format_t;
+
+typedef enum {
+    TELEMETRY_REC_TEXT = 0x01,    // UART_Printf text: command responses and infrequent records
+    TELEMETRY_REC_SAMPLE = 0x02,  // every conversion
+    TELEMETRY_REC_CYCLE = 0x03,   // every analyzer window
+    TELEMETRY_REC_FIT = 0x04,     // cure model prediction
+} telemetry_rec_t;
+
+#define TELEMETRY_MODE_IDLE     0
+#define TELEMETRY_MODE_RUN      1
+#define TELEMETRY_MODE_SWEEP    2
+
+// TELEMETRY_REC_SAMPLE, 21 bytes: u8 mode, u32 seq, u32 t_us (wraps), i32 raw, f32 torque, f32 amp_live
+typedef struct {
+    uint8_t mode;
+    uint32_t seq;
+    int64_t t_us;
+    int32_t raw;
+    float torque;
+    float amp_live;
+} telemetry_sample_t;
+
+#define TELEMETRY_CYCLE_LOCKED  0x01
+#define TELEMETRY_CYCLE_QUAD    0x02    // amp_fit valid; phase_deg, tan_delta only with INDEX (NaN otherwise)
+#define TELEMETRY_CYCLE_HARM    0x04    // rms, thd, harm[] valid
+#define TELEMETRY_CYCLE_INDEX   0x08    // quadrature against the die index
+
+// TELEMETRY_REC_CYCLE, 71 bytes: u8 mode, u8 flags, u8 step, u32 start_us (wraps), u32 period_us,
+// f32 amp, amp_filtered, min, max, freq_hz, amp_fit, phase_deg, tan_delta, rms, thd, harm[5]
+typedef struct {
+    uint8_t mode;
+    uint8_t flags;
+    uint8_t step;                 // sweep step, 0 otherwise
+    int64_t start_us;
+    int64_t period_us;
+    float amp;
+    float amp_filtered;
+    float min;
+    float max;
+    float freq_hz;
+    float amp_fit;
+    float phase_deg;
+    float tan_delta;
+    float rms;
+    float thd;
+    float harm[5];
+} telemetry_cycle_t;
+
+// TELEMETRY_REC_FIT, 30 bytes: f32 mh, mh_ci_lo, mh_ci_hi, k, t90, t90_ci_lo, t90_ci_hi, u16 points
+// (approximate 95 % bounds, see cure_fit.h)
+typedef struct {
+    float mh, mh_ci_lo, mh_ci_hi;
+    float k;
+    float t90, t90_ci_lo, t90_ci_hi;
+    uint16_t points;
+} telemetry_fit_t;
+
+/* Exported functions */
+void Telemetry_SetFormat(telemetry_format_t format);
+telemetry_format_t Telemetry_GetFormat(void);
+void Telemetry_SendText(uart_tx_lane_t lane, const char *text, size_t len);
+void Telemetry_SendSample(const telemetry_sample_t *rec);
+void Telemetry_SendCycle(const telemetry_cycle_t *rec);
+void Telemetry_SendFit(const telemetry_fit_t *rec);
+uint16_t telemetry_crc16(uint16_t crc, const uint8_t *data, size_t len);
+
+#endif /* TELEMETRY_H */
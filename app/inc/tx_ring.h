@@ -0,0 +1,47 @@
+#ifndef TX_RING_H
+#define TX_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TX_RING_ALIGN       16        // record granularity
+#define TX_RING_MAX_RECORD  1024      // largest record accepted; a ring holds at least two
+
+/* Exported types */
+typedef enum {
+    TX_DROP_NEWEST = 0,           // a full ring rejects the new record
+    TX_DROP_OLDEST,               // a full ring discards queued records to make room
+} tx_ring_policy_t;
+
+typedef struct {
+    uint32_t records;             // records queued
+    uint32_t dropped_newest;      // rejected on overflow
+    uint32_t dropped_oldest;      // discarded to make room
+    uint32_t dropped_bytes;       // payload lost either way
+    uint32_t high_water;          // most bytes ever in use
+} tx_ring_stats_t;
+
+// Multi-producer, single-consumer record ring. Producers reserve space with a
+// compare-and-swap on head and never wait; a record becomes visible to the
+// consumer when its stamp (kept outside the data, so stale bytes can never
+// look committed) is set to its position. Storage is supplied by the owner,
+// so a ring can be set up by a static initializer and used before any init code runs.
+typedef struct {
+    uint8_t *buf;                 // size bytes, 4-byte aligned
+    uint32_t *stamp;              // size / TX_RING_ALIGN entries, zeroed
+    uint32_t size;                // power of two
+    uint32_t head;                // reserved up to here (producers)
+    uint32_t tail;                // released up to here (consumer, or a drop-oldest producer)
+    volatile tx_ring_policy_t policy;
+    tx_ring_stats_t stats;
+} tx_ring_t;
+
+/* Exported functions */
+void tx_ring_init(tx_ring_t *ring, uint8_t *buf, uint32_t *stamp, uint32_t size, tx_ring_policy_t policy);
+uint8_t tx_ring_write(tx_ring_t *ring, const void *data, size_t len);
+size_t tx_ring_read(tx_ring_t *ring, void *out, size_t out_sz);
+size_t tx_ring_used(const tx_ring_t *ring);
+void tx_ring_get_stats(const tx_ring_t *ring, tx_ring_stats_t *stats);
+void tx_ring_reset_stats(tx_ring_t *ring);
+
+#endif /* TX_RING_H */
@@ -0,0 +1,27 @@
+#ifndef UART_TX_SVC_H
+#define UART_TX_SVC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "tx_ring.h"
+
+/* Exported types */
+// Output lanes in strict priority order: a queued record is sent only when
+// every lane above it is empty. Records are never split or interleaved.
+typedef enum {
+    UART_TX_RESPONSE = 0,         // command replies
+    UART_TX_EVENT,                // status changes and one-off messages (UART_Printf)
+    UART_TX_BULK,                 // per-sample and per-cycle telemetry
+    UART_TX_LANES
+} uart_tx_lane_t;
+
+/* Exported functions */
+void UartTx_Init(void);
+uint8_t UartTx_Write(uart_tx_lane_t lane, const void *data, size_t len);
+void UartTx_SetPolicy(uart_tx_lane_t lane, tx_ring_policy_t policy);
+tx_ring_policy_t UartTx_GetPolicy(uart_tx_lane_t lane);
+void UartTx_GetStats(uart_tx_lane_t lane, tx_ring_stats_t *stats);
+uint32_t UartTx_GetSize(uart_tx_lane_t lane);
+void UartTx_ResetStats(void);
+
+#endif /* UART_TX_SVC_H */
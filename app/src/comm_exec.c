@@ -1,14 +1,33 @@
 #include "comm_exec.h"
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>  // For uint16_t
+#include <math.h>
 #include "esp_log.h"
 #include "driver/uart.h"
+#include "freertos/queue.h"
 #include "eeprom.h"
+#include "cycle_analyzer.h"
+#include "cure_run.h"
+#include "sweep.h"
+#include "telemetry.h"
+#include "json_tok.h"
+#include "uart_tx_svc.h"
+#include "strain_ref_svc.h"
+
+#define COMM_UART                 UART_NUM_0
+#define COMM_UART_BAUD            115200
+#define COMM_UART_RX_BUF          2048      // driver RX ring; a line must fit
+#define COMM_UART_EVENT_QUEUE     20
+#define COMM_PATTERN_QUEUE        16        // line ends remembered ahead of the reader
+#define COMM_RXBUF_SIZE           256
+#define COMM_LINEBUF_SIZE         256
 
 /* Private variables */
 TaskHandle_t CommTaskHandle;
+static QueueHandle_t CommUartQueue;       // UART driver events
 
 // --- Global runtime state for modes and MDR ---
 static float g_ADC_zero = 0.0f;          // offset
@@ -16,9 +35,30 @@ static float g_K_T = 0.0f;               // Nm per count
 static uint32_t g_run_time_s = 60;       // default run duration (seconds)
 static uint32_t g_run_start_ms = 0;
 
+// MDR die oscillation frequency (per MDR reference)
+#define MDR_CYCLE_FREQ_HZ   1.66f
+
 // Global variable for idle amplitude tare request
 double g_idle_amp_tare_request = 0.0;
 
+// Cycle analysis of the torque stream (owned by ModeTask; smoothing via set_filter,
+// window via set_window). Run adds the quadrature fit and harmonics per cycle.
+static cycle_analyzer_t g_idle_analyzer;  // default 2-window moving average
+static cycle_analyzer_t g_run_analyzer;   // default 5-window moving average
+
+// Cure analytics over the run's cycle amplitudes: curve, online first-order
+// model (MH and t90 predicted while the run is in progress) and plateau
+static cure_run_t g_cure_run;
+
+// Frequency sweep (mode 2): plan from set_sweep, taken at sweep start
+static sweep_step_t g_sweep_plan[SWEEP_MAX_STEPS];
+static uint8_t g_sweep_steps = 0;
+static sweep_t g_sweep;
+
+// Optional end of run on the cure plateau (off until set_plateau, applied at run start)
+static float g_plateau_slope = 0.0f;      // N·m/min
+static float g_plateau_window_s = 60.0f;
+
 // Command parsing disabled on ESP32 build for now
 
 /* Private function prototypes */
@@ -37,16 +77,24 @@ void CommTask_Init(void)
 {
   /* Configure UART0 for USB-UART bridge echo */
   const uart_config_t uart_config = {
-    .baud_rate = 115200,
+    .baud_rate = COMM_UART_BAUD,
     .data_bits = UART_DATA_8_BITS,
     .parity = UART_PARITY_DISABLE,
     .stop_bits = UART_STOP_BITS_1,
     .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
     .source_clk = UART_SCLK_APB,
   };
-  uart_driver_install(UART_NUM_0, 2048, 2048, 0, NULL, 0);
-  uart_param_config(UART_NUM_0, &uart_config);
-  uart_set_pin(UART_NUM_0, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+  // No TX buffer: the output task writes straight to the FIFO, so lane priority
+  // is not undone by bulk records already queued in the driver
+  uart_driver_install(COMM_UART, COMM_UART_RX_BUF, 0, COMM_UART_EVENT_QUEUE, &CommUartQueue, 0);
+  uart_param_config(COMM_UART, &uart_config);
+  uart_set_pin(COMM_UART, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+  // Every '\n' raises a pattern event, so CommTask wakes once per complete line
+  uart_enable_pattern_det_baud_intr(COMM_UART, '\n', 1, 9, 0, 0);
+  uart_pattern_queue_reset(COMM_UART, COMM_PATTERN_QUEUE);
+
+  /* Output task draining the reply, event and bulk lanes (queued records included) */
+  UartTx_Init();
 
   /* Load MDR calibration data from EEPROM */
   eeprom_calibration_data_t data = {0};
@@ -59,9 +107,27 @@ void CommTask_Init(void)
     UART_Printf("No MDR calibration found in EEPROM\r\n");
   }
 
-  /* Create the task */
-  xTaskCreate(CommTask_Function, "CommTask", 4096, NULL, tskIDLE_PRIORITY+1, &CommTaskHandle);
-  xTaskCreate(ModeTask_Function, "ModeTask", 4096, NULL, tskIDLE_PRIORITY+1, &ModeTaskHandle);
+  /* Die position index for S'/S'' (when fitted) */
+  StrainRef_Init();
+
+  /* Cycle analyzers */
+  const cycle_analyzer_config_t idle_cfg = {
+    .nominal_hz = MDR_CYCLE_FREQ_HZ, .window_cycles = 1,
+    .smoothing = { .type = FILTER_MA, .window = 2 },
+  };
+  const cycle_analyzer_config_t run_cfg = {
+    .nominal_hz = MDR_CYCLE_FREQ_HZ, .window_cycles = 1,
+    .smoothing = { .type = FILTER_MA, .window = 5 },
+    .quadrature = 1, .ref = StrainRef_Get,
+  };
+  cycle_analyzer_init(&g_idle_analyzer, &idle_cfg);
+  cycle_analyzer_init(&g_run_analyzer, &run_cfg);
+
+  /* Create the task. Both format JSON lines (UART_VPrintf buffer, float snprintf)
+     and binary frames on their stacks; ModeTask also builds the quadrature fields.
+     Check the margin with get_stack. */
+  xTaskCreate(CommTask_Function, "CommTask", 6144, NULL, tskIDLE_PRIORITY+1, &CommTaskHandle);
+  xTaskCreate(ModeTask_Function, "ModeTask", 8192, NULL, tskIDLE_PRIORITY+1, &ModeTaskHandle);
 }
 
 /**
@@ -74,7 +140,7 @@ void CommTask_Start(void)
   /* No-op on ESP32 */
 }
 
-/* UART_Printf is provided in config.c */
+/* UART_Printf, UART_Reply and UART_Stream are provided in config.c */
 
 /**
   * @brief Parse incoming command
@@ -90,38 +156,120 @@ void CommTask_Start(void)
   */
 /* ---- Internal helpers for modularity ---- */
 
-#define COMM_UART                 UART_NUM_0
-#define COMM_UART_BAUD            115200
-#define COMM_RXBUF_SIZE           256
-#define COMM_LINEBUF_SIZE         256
+static void reply_ok(const char *cmd)
+{
+  if (cmd) {
+    UART_Reply("{\"ok\":true,\"cmd\":\"%s\"}\r\n", cmd);
+  } else {
+    UART_Reply("{\"ok\":true}\r\n");
+  }
+}
 
-static void uart_init_defaults(void)
+static void reply_err(const char *err)
 {
-  const uart_config_t uart_config = {
-    .baud_rate = COMM_UART_BAUD,
-    .data_bits = UART_DATA_8_BITS,
-    .parity = UART_PARITY_DISABLE,
-    .stop_bits = UART_STOP_BITS_1,
-    .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
-    .source_clk = UART_SCLK_APB,
+  UART_Reply("{\"ok\":false,\"err\":\"%s\"}\r\n", err ? err : "error");
+}
+
+static float mdr_torque(int32_t raw)
+{
+  return (g_K_T > 0.0f) ? (float)((double)raw - (double)g_ADC_zero) * g_K_T : 0.0f;
+}
+
+/* Run record fields from the quadrature fit and harmonics of a window, if any,
+   and the crest times when min/max are interpolated */
+static void mdr_format_quad(const cycle_analyzer_t *ca, const cycle_window_t *w, char *out, size_t out_sz)
+{
+  int len = 0;
+  out[0] = '\0';
+  if (ca->cfg.peak_mode != CYCLE_PEAK_SAMPLE) {
+    len = snprintf(out, out_sz, ",\"t_min_ms\":%.1f,\"t_max_ms\":%.1f",
+                   (double)(w->t_min_us - w->start_us) / 1000.0, (double)(w->t_max_us - w->start_us) / 1000.0);
+  }
+  if (w->has_quad && w->quad_ref && len >= 0 && (size_t)len < out_sz) {
+    const lockin_result_t *q = &w->quad;
+    len += snprintf(out + len, out_sz - len, ",\"amp_fit\":%.6f,\"phase_deg\":%.3f,\"s_prime\":%.6f,\"s_dprime\":%.6f,\"tan_delta\":%.5f,\"ref\":\"index\"",
+                   q->amp, q->phase_deg, q->s_prime, q->s_dprime, q->tan_delta);
+  } else if (w->has_quad && len >= 0 && (size_t)len < out_sz) {
+    // No die index: the phase against the torque's own zero crossing is not a measurement
+    len += snprintf(out + len, out_sz - len, ",\"amp_fit\":%.6f,\"phase_deg\":null,\"s_prime\":null,\"s_dprime\":null,\"tan_delta\":null,\"ref\":\"torque\"",
+                   w->quad.amp);
+  }
+  if (w->has_harm && len >= 0 && (size_t)len < out_sz) {
+    len += snprintf(out + len, out_sz - len, ",\"rms\":%.6f", w->harm.rms);
+    for (uint8_t k = 0; k < LOCKIN_HARMONICS && len >= 0 && (size_t)len < out_sz; k++) {
+      len += snprintf(out + len, out_sz - len, "%s%.6f", (k == 0) ? ",\"harm\":[" : ",", w->harm.mag[k]);
+    }
+    if (len >= 0 && (size_t)len < out_sz) {
+      snprintf(out + len, out_sz - len, "],\"thd\":%.5f", w->harm.thd);
+    }
+  }
+}
+
+static const char *tx_policy_name(uart_tx_lane_t lane)
+{
+  return (UartTx_GetPolicy(lane) == TX_DROP_OLDEST) ? "drop_oldest" : "drop_newest";
+}
+
+/* Binary telemetry (set_telemetry): every conversion and every window as fixed records */
+static uint8_t mdr_binary(void)
+{
+  return Telemetry_GetFormat() == TELEMETRY_BINARY;
+}
+
+static void mdr_send_sample(uint8_t m, const LoadCell_Sample_t *s, double torque, double amp_live)
+{
+  const telemetry_sample_t rec = {
+    .mode = m, .seq = s->seq, .t_us = s->timestamp_us, .raw = s->raw,
+    .torque = (float)torque, .amp_live = (float)amp_live,
   };
-  uart_driver_install(COMM_UART, 2048, 2048, 0, NULL, 0);
-  uart_param_config(COMM_UART, &uart_config);
-  uart_set_pin(COMM_UART, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+  Telemetry_SendSample(&rec);
 }
 
-static void reply_ok(const char *cmd)
+static void mdr_send_cycle(uint8_t m, uint8_t step, const cycle_window_t *w, double amp_filtered)
 {
-  if (cmd) {
-    UART_Printf("{\"ok\":true,\"cmd\":\"%s\"}\r\n", cmd);
-  } else {
-    UART_Printf("{\"ok\":true}\r\n");
+  telemetry_cycle_t rec = {
+    .mode = m, .step = step, .start_us = w->start_us, .period_us = w->period_us,
+    .amp = (float)w->amp, .amp_filtered = (float)amp_filtered,
+    .min = (float)w->min, .max = (float)w->max, .freq_hz = (float)w->freq_hz,
+  };
+  rec.flags = w->locked ? TELEMETRY_CYCLE_LOCKED : 0;
+  if (w->has_quad) {
+    rec.flags |= TELEMETRY_CYCLE_QUAD | (w->quad_ref ? TELEMETRY_CYCLE_INDEX : 0);
+    rec.amp_fit = (float)w->quad.amp;
+    rec.phase_deg = w->quad_ref ? (float)w->quad.phase_deg : NAN;
+    rec.tan_delta = w->quad_ref ? (float)w->quad.tan_delta : NAN;
+  }
+  if (w->has_harm) {
+    rec.flags |= TELEMETRY_CYCLE_HARM;
+    rec.rms = (float)w->harm.rms;
+    rec.thd = (float)w->harm.thd;
+    for (uint8_t k = 0; k < LOCKIN_HARMONICS && k < 5; k++) {
+      rec.harm[k] = (float)w->harm.mag[k];
+    }
   }
+  Telemetry_SendCycle(&rec);
 }
 
-static void reply_err(const char *err)
+/* Sweep step boundary: report the settled point and retune for the next frequency */
+static void mdr_sweep_step(int done)
 {
-  UART_Printf("{\"ok\":false,\"err\":\"%s\"}\r\n", err ? err : "error");
+  const sweep_point_t *p = &g_sweep.table[done];
+  if (p->ref_index) {
+    UART_Printf("{\"mode\":\"sweep\",\"point\":%d,\"freq_hz\":%.3f,\"freq_meas\":%.4f,\"amp\":%.6f,\"ref\":\"index\",\"phase_deg\":%.3f,"
+                "\"s_prime\":%.6f,\"s_dprime\":%.6f,\"tan_delta\":%.5f,\"cycles\":%u}\r\n",
+                done, p->freq_hz, p->freq_meas, p->amp, p->phase_deg, p->s_prime, p->s_dprime, p->tan_delta, (unsigned)p->cycles);
+  } else {
+    // No die index: the phase of the torque against its own zero crossing means nothing
+    UART_Printf("{\"mode\":\"sweep\",\"point\":%d,\"freq_hz\":%.3f,\"freq_meas\":%.4f,\"amp\":%.6f,\"ref\":\"torque\",\"phase_deg\":null,"
+                "\"s_prime\":null,\"s_dprime\":null,\"tan_delta\":null,\"cycles\":%u}\r\n",
+                done, p->freq_hz, p->freq_meas, p->amp, (unsigned)p->cycles);
+  }
+  const sweep_step_t *st = sweep_current(&g_sweep);
+  if (st != NULL) {
+    cycle_analyzer_set_nominal(&g_run_analyzer, st->freq_hz);
+    UART_Printf("{\"mode\":\"sweep\",\"step\":%u,\"freq_hz\":%.3f,\"dwell_s\":%.1f}\r\n",
+                (unsigned)g_sweep.index, st->freq_hz, st->dwell_s);
+  }
 }
 
 static void relays_all_off(void)
@@ -144,10 +292,17 @@ static void compute_offset_over_ms(uint32_t ms)
 {
   const uint32_t end = (uint32_t)(xTaskGetTickCount()) + pdMS_TO_TICKS(ms);
   double s = 0.0; uint32_t n = 0;
+  LoadCell_Sample_t snap;
+  LoadCell_GetSnapshot(&snap);
+  uint32_t last_seq = snap.seq;
   while ((uint32_t)xTaskGetTickCount() < end) {
-    int32_t raw = LoadCell_GetRaw();
-    s += (double)raw;
-    n++;
+    // Count each conversion once
+    LoadCell_GetSnapshot(&snap);
+    if (snap.seq != last_seq) {
+      last_seq = snap.seq;
+      s += (double)snap.raw;
+      n++;
+    }
     vTaskDelay(pdMS_TO_TICKS(5));
   }
   if (n > 0) g_ADC_zero = (float)(s / (double)n);
@@ -157,11 +312,17 @@ static void compute_KT_over_ms(uint32_t ms, float known_torque_nm)
 {
   const uint32_t end = (uint32_t)(xTaskGetTickCount()) + pdMS_TO_TICKS(ms);
   double vmin = 1e300, vmax = -1e300;
+  LoadCell_Sample_t snap;
+  LoadCell_GetSnapshot(&snap);
+  uint32_t last_seq = snap.seq;
   while ((uint32_t)xTaskGetTickCount() < end) {
-    int32_t raw = LoadCell_GetRaw();
-    double corr = (double)raw - (double)g_ADC_zero;
-    if (corr < vmin) vmin = corr;
-    if (corr > vmax) vmax = corr;
+    LoadCell_GetSnapshot(&snap);
+    if (snap.seq != last_seq) {
+      last_seq = snap.seq;
+      double corr = (double)snap.raw - (double)g_ADC_zero;
+      if (corr < vmin) vmin = corr;
+      if (corr > vmax) vmax = corr;
+    }
     vTaskDelay(pdMS_TO_TICKS(5));
   }
   double amp = (vmax - vmin) / 2.0;
@@ -170,252 +331,716 @@ static void compute_KT_over_ms(uint32_t ms, float known_torque_nm)
   }
 }
 
-/* Lightweight JSON helpers (simple extractors) */
-static int find_key_str(const char *json, const char *key, char *out, size_t out_sz)
+/* ---- Command table ----
+   Each command names its arguments with a type and range; handle_line()
+   tokenizes the line once (json_tok), finds the command by name hash and
+   binds every member to the schema before the handler runs, so handlers
+   only see present, typed, in-range values. Unknown or mistyped keys are
+   rejected with {"ok":false,"err":"bad_args","arg":"<key>"}. */
+
+#define COMM_MAX_ARGS   4
+#define COMM_NAME_MAX   24        // command name bytes covered by the hash
+
+// FNV-1a over the name zero-padded to COMM_NAME_MAX bytes; folds to a constant for string literals
+#define COMM_HASH_CH(s, i)      ((i) < sizeof(s) - 1 ? (uint8_t)(s)[(i) < sizeof(s) - 1 ? (i) : 0] : 0u)
+#define COMM_HASH_1(h, s, i)    (((h) ^ COMM_HASH_CH(s, i)) * 16777619u)
+#define COMM_HASH_4(h, s, i)    COMM_HASH_1(COMM_HASH_1(COMM_HASH_1(COMM_HASH_1(h, s, i), s, i + 1), s, i + 2), s, i + 3)
+#define COMM_HASH(s)            ((uint32_t)COMM_HASH_4(COMM_HASH_4(COMM_HASH_4(COMM_HASH_4(COMM_HASH_4(COMM_HASH_4( \
+                                    2166136261u, s, 0), s, 4), s, 8), s, 12), s, 16), s, 20))
+
+typedef enum {
+  ARG_NUM = 0,                  // number within [min, max]
+  ARG_INT,                      // integral number within [min, max]
+  ARG_STR,                      // string without escapes, at most count bytes
+  ARG_NUM_LIST,                 // number, or array of 1..count numbers, each within [min, max]
+} comm_arg_type_t;
+
+#define ARG_REQ       1
+#define ARG_OPT       0
+#define ARG_HUGE      1e300                     // no practical bound
+#define ARG_INT_MIN   -2147483648.0             // int range, so handlers can cast
+#define ARG_INT_MAX   2147483647.0
+
+typedef struct {
+  const char *key;
+  comm_arg_type_t type;
+  uint8_t required;
+  double min, max;
+  uint8_t count;
+} comm_arg_t;
+
+// Bound argument, in schema order
+typedef struct {
+  uint8_t present;
+  double num;                   // ARG_NUM, ARG_INT
+  const char *str;              // ARG_STR, NUL-terminated in the line buffer
+  const json_value_t *list;     // ARG_NUM_LIST: list[i].num (a single number counts as one)
+  uint8_t count;
+} comm_val_t;
+
+typedef struct {
+  uint32_t hash;
+  const char *name;
+  void (*handler)(const comm_val_t *arg);
+  const comm_arg_t *args;
+  uint8_t nargs;
+} comm_cmd_t;
+
+#define ARG_NUM_IN(key, req, lo, hi)        { key, ARG_NUM, req, lo, hi, 0 }
+#define ARG_INT_IN(key, req, lo, hi)        { key, ARG_INT, req, lo, hi, 0 }
+#define ARG_STR_MAX(key, req, len)          { key, ARG_STR, req, 0, 0, len }
+#define ARG_LIST_IN(key, req, lo, hi, n)    { key, ARG_NUM_LIST, req, lo, hi, n }
+
+#define COMM_CMD(name, fn, schema)  { COMM_HASH(name), name, fn, schema, sizeof(schema) / sizeof(schema[0]) }
+#define COMM_CMD_NOARGS(name, fn)   { COMM_HASH(name), name, fn, NULL, 0 }
+
+static void reply_err_arg(const char *key, size_t key_len)
+{
+  UART_Reply("{\"ok\":false,\"err\":\"bad_args\",\"arg\":\"%.*s\"}\r\n", (int)key_len, key);
+}
+
+static void cmd_rtd_calib(const comm_val_t *arg)
+{
+  RTD_Temp_CalibrateAndSave((uint8_t)arg[0].num, (float)arg[1].num);
+  reply_ok("rtd_calib");
+}
+
+static void cmd_set_temp(const comm_val_t *arg)
+{
+  RTD_Temp_SetTempSetPoint((float)arg[0].num);
+  reply_ok("set_temp");
+}
+
+static void cmd_set_temp_rtd(const comm_val_t *arg)
+{
+  int device = (int)arg[0].num;
+  double temp = arg[1].num;
+
+  // Validate device number (1-2)
+  if (device >= 1 && device <= 2) {
+    RTD_Temp_SetTempSetPointIndividual((uint8_t)device, (float)temp);
+    UART_Reply("{\"ok\":true,\"cmd\":\"set_temp_rtd\",\"dev\":%d,\"temp\":%.2f}\r\n", device, temp);
+  } else {
+    reply_err("invalid_device");
+  }
+}
+
+static void cmd_get_temp(const comm_val_t *arg)
 {
-  char pattern[32];
-  snprintf(pattern, sizeof(pattern), "\"%s\":\"", key);
-  const char *p = strstr(json, pattern);
-  if (!p) return 0;
-  p += strlen(pattern);
-  const char *q = strchr(p, '"');
-  if (!q || (size_t)(q - p) >= out_sz) return 0;
-  memcpy(out, p, (size_t)(q - p));
-  out[q - p] = '\0';
-  return 1;
+  float t1 = RTD_Temp_GetTemperature(1);
+  float t2 = RTD_Temp_GetTemperature(2);
+  UART_Reply("{\"t1\":%.2f,\"t2\":%.2f}\r\n", t1, t2);
 }
 
-static int find_key_num(const char *json, const char *key, double *val)
+static void cmd_set_mode(const comm_val_t *arg)
 {
-  char pattern[32];
-  snprintf(pattern, sizeof(pattern), "\"%s\":", key);
-  const char *p = strstr(json, pattern);
-  if (!p) return 0;
-  p += strlen(pattern);
-  *val = atof(p);
-  return 1;
+  const char *val = arg[0].str;
+  if (strcmp(val, "powerup") == 0) { mode = 0; relays_all_off(); reply_ok("set_mode"); return; }
+  if (strcmp(val, "idle") == 0)    { mode = 0; relays_all_off(); reply_ok("set_mode"); return; }
+  if (strcmp(val, "run") == 0)     { mode = 1; triggerFlg = 1; g_run_start_ms = (uint32_t)(xTaskGetTickCount()); reply_ok("set_mode"); return; }
+  if (strcmp(val, "stop") == 0)    { mode = 0; relays_all_off(); UART_Reply("{\"mode\":\"run\",\"status\":\"finished\"}\r\n"); return; }
+  if (strcmp(val, "calib") == 0)   { mode = 3; reply_ok("set_mode"); return; }
+  if (strcmp(val, "sweep") == 0) {
+    if (g_sweep_steps == 0) { reply_err("no_sweep_plan"); return; }
+    mode = 2; reply_ok("set_mode"); return;
+  }
+  reply_err("bad_args");
 }
 
-static void handle_line(const char *line)
+static void cmd_set_run_time(const comm_val_t *arg)
 {
-  ESP_LOGI("UART", "Received %s", line);
-  char cmd[32];
-  if (!find_key_str(line, "cmd", cmd, sizeof(cmd))) { reply_err("bad_json"); return; }
-  ESP_LOGI("UART", "cmd: %s", cmd);
-  if (strcmp(cmd, "rtd_calib") == 0) {
-    double dev_d = 0, known_d = 0;
-    if (find_key_num(line, "dev", &dev_d) && find_key_num(line, "known", &known_d)) {
-      RTD_Temp_CalibrateAndSave((uint8_t)dev_d, (float)known_d);
-      reply_ok("rtd_calib");
-    } else {
-      reply_err("bad_args");
-    }
-        return;
-    }
-    
-  if (strcmp(cmd, "set_temp") == 0) {
-    double v = 0;
-    if (find_key_num(line, "value", &v)) {
-      RTD_Temp_SetTempSetPoint((float)v);
-      reply_ok("set_temp");
-    } else {
-      reply_err("bad_args");
-    }
-        return;
+  double sec = arg[0].num;
+  if (sec <= 0) { reply_err("bad_args"); return; }
+  g_run_time_s = (uint32_t)sec;
+  UART_Reply("set_run_time: %u seconds\r\n", (uint32_t)sec);
+  offTime = (uint32_t)sec; // Also update legacy variable for compatibility
+  reply_ok("set_run_time");
+}
+
+static void cmd_set_plateau(const comm_val_t *arg)
+{
+  double slope = arg[0].num;
+  double window = arg[1].present ? arg[1].num : 60.0;
+  g_plateau_slope = (float)slope;
+  g_plateau_window_s = (float)window;
+  UART_Reply("{\"ok\":true,\"cmd\":\"set_plateau\",\"slope\":%.5f,\"window_s\":%.1f}\r\n", slope, window);
+}
+
+static void cmd_set_sweep(const comm_val_t *arg)
+{
+  uint8_t nf = arg[0].count, nd = arg[1].count;
+  // One dwell for every step, or one per step
+  if ((nd != 1 && nd != nf) || mode == 2) { reply_err("bad_args"); return; }
+  // The lock-in needs a whole cycle in its buffer and enough conversions per cycle at the measured rate
+  hx711_stat_t iv, lat;
+  LoadCell_GetStats(&iv, &lat);
+  double sps = (iv.count > 0 && iv.mean_us > 0.0) ? 1e6 / iv.mean_us : 0.0;
+  float min_hz, max_hz;
+  sweep_freq_range(sps, &min_hz, &max_hz);
+  for (uint8_t i = 0; i < nf; i++) {
+    float f = (float)arg[0].list[i].num;
+    if (f < min_hz || f > max_hz) {
+      UART_Reply("{\"ok\":false,\"err\":\"freq_vs_sps\",\"freq_hz\":%.3f,\"sps\":%.2f,\"min_hz\":%.3f,\"max_hz\":%.3f}\r\n",
+                 f, sps, min_hz, max_hz);
+      return;
     }
+  }
+  for (uint8_t i = 0; i < nf; i++) {
+    g_sweep_plan[i].freq_hz = (float)arg[0].list[i].num;
+    g_sweep_plan[i].dwell_s = (float)arg[1].list[(nd == 1) ? 0 : i].num;
+  }
+  g_sweep_steps = nf;
+  UART_Reply("{\"ok\":true,\"cmd\":\"set_sweep\",\"steps\":%d}\r\n", nf);
+}
 
-  if (strcmp(cmd, "set_temp_rtd") == 0) {
-    double dev = 0, temp = 0;
-    if (find_key_num(line, "dev", &dev) && find_key_num(line, "temp", &temp)) {
-      int device = (int)dev;
-      
-      // Validate device number (1-2)
-      if (device >= 1 && device <= 2) {
-        RTD_Temp_SetTempSetPointIndividual((uint8_t)device, (float)temp);
-        UART_Printf("{\"ok\":true,\"cmd\":\"set_temp_rtd\",\"dev\":%d,\"temp\":%.2f}\r\n", device, temp);
-      } else {
-        reply_err("invalid_device");
-      }
-    } else {
-      reply_err("bad_args");
+static void cmd_calibrate_mdr(const comm_val_t *arg)
+{
+  double w = arg[0].num, lever = arg[1].num;
+  if (w <= 0 || lever <= 0) { reply_err("bad_args"); return; }
+  compute_offset_over_ms(60000);
+  relays_sequence_on();
+  float T_cal = (float)(w * 9.81 * lever);
+  compute_KT_over_ms(60000, T_cal);
+  relays_all_off();
+
+  // Save MDR calibration to EEPROM
+  if (EEPROM_SaveMDRCalibration(g_ADC_zero, g_K_T) == ESP_OK) {
+    UART_Reply("Saved MDR calibration to EEPROM\r\n");
+  } else {
+    UART_Reply("Failed to save MDR calibration to EEPROM\r\n");
+  }
+
+  UART_Reply("{\"ok\":true,\"cmd\":\"calibrate_mdr\",\"ADC_zero\":%.3f,\"K_T\":%.9f}\r\n", g_ADC_zero, g_K_T);
+}
+
+static void cmd_offset_mdr(const comm_val_t *arg)
+{
+  double ms = arg[0].present ? arg[0].num : 5000;
+  relays_all_off();
+  compute_offset_over_ms((uint32_t)ms);
+
+  // Save MDR offset to EEPROM
+  if (EEPROM_SaveMDRCalibration(g_ADC_zero, g_K_T) == ESP_OK) {
+    UART_Reply("Saved MDR offset to EEPROM\r\n");
+  } else {
+    UART_Reply("Failed to save MDR offset to EEPROM\r\n");
+  }
+
+  UART_Reply("{\"ok\":true,\"cmd\":\"offset_mdr\",\"ADC_zero\":%.3f}\r\n", g_ADC_zero);
+}
+
+static void cmd_tare_idle_amp(const comm_val_t *arg)
+{
+  // This command will be handled by setting a flag that the ModeTask will read
+  // We'll use a global variable to communicate between CommTask and ModeTask
+  extern double g_idle_amp_tare_request;
+  g_idle_amp_tare_request = 1.0; // Set flag to request tare
+  reply_ok("tare_idle_amp");
+}
+
+static void cmd_set_relay(const comm_val_t *arg)
+{
+  int relay = (int)arg[0].num;
+  int relay_state = (int)arg[1].num;
+
+  // Validate relay number (1-4) and state (0-1)
+  if (relay >= 1 && relay <= 4 && (relay_state == 0 || relay_state == 1)) {
+    Relay_SSR_SetRelay((uint8_t)relay, (uint8_t)relay_state);
+    UART_Reply("{\"ok\":true,\"cmd\":\"set_relay\",\"relay\":%d,\"state\":%d}\r\n", relay, relay_state);
+  } else {
+    reply_err("invalid_relay_or_state");
+  }
+}
+
+static void cmd_set_loadcell_gain(const comm_val_t *arg)
+{
+  double gain = arg[0].num;
+  if (gain != 128 && gain != 64) { reply_err("bad_args"); return; }
+  if (!LoadCell_SetGain(gain == 128 ? HX711_GAIN_A_128 : HX711_GAIN_A_64)) { reply_err("not_supported"); return; }
+  UART_Reply("{\"ok\":true,\"cmd\":\"set_loadcell_gain\",\"gain\":%d}\r\n", (int)gain);
+}
+
+static void cmd_set_loadcell_mux(const comm_val_t *arg)
+{
+  uint16_t ratio_a = (uint16_t)arg[0].num;
+  uint16_t ratio_b = arg[1].present ? (uint16_t)arg[1].num : 1;
+  if (!LoadCell_SetChannelMux(ratio_a, ratio_b)) { reply_err("not_supported"); return; }
+  UART_Reply("{\"ok\":true,\"cmd\":\"set_loadcell_mux\",\"ratio_a\":%u,\"ratio_b\":%u}\r\n", (unsigned)ratio_a, (unsigned)ratio_b);
+}
+
+static void cmd_get_loadcell_b(const comm_val_t *arg)
+{
+  UART_Reply("{\"ok\":true,\"cmd\":\"get_loadcell_b\",\"raw_b\":%ld}\r\n", (long)LoadCell_GetRawB());
+}
+
+static void cmd_get_loadcells(const comm_val_t *arg)
+{
+  char buf[256];
+  size_t n = 0;
+  buf[0] = '\0';
+  for (uint8_t ch = 0; ch < LoadCell_GetChannelCount(); ch++) {
+    int len = snprintf(buf + n, sizeof(buf) - n, "%s{\"ch\":%u,\"raw\":%ld,\"weight\":%.3f}",
+                       ch ? "," : "", (unsigned)ch, (long)LoadCell_GetChannelRaw(ch), LoadCell_GetChannelWeight(ch));
+    if (len < 0 || (size_t)len >= sizeof(buf) - n) {
+      buf[n] = '\0';   // drop the truncated entry, keep the array well-formed
+      break;
     }
+    n += (size_t)len;
+  }
+  UART_Reply("{\"ok\":true,\"cmd\":\"get_loadcells\",\"channels\":[%s]}\r\n", buf);
+}
+
+static void cmd_set_loadcell_cal(const comm_val_t *arg)
+{
+  double ch = arg[0].num, coef = arg[2].num;
+  if (ch >= LoadCell_GetChannelCount() || coef == 0.0) { reply_err("bad_args"); return; }
+  LoadCell_SetChannelCal((uint8_t)ch, (int32_t)arg[1].num, (float)coef);
+  reply_ok("set_loadcell_cal");
+}
+
+static void cmd_tare_loadcell(const comm_val_t *arg)
+{
+  double ch = arg[0].num;
+  if (ch >= LoadCell_GetChannelCount()) { reply_err("bad_args"); return; }
+  LoadCell_TareChannel((uint8_t)ch);
+  reply_ok("tare_loadcell");
+}
+
+static void cmd_get_loadcell_stats(const comm_val_t *arg)
+{
+  hx711_stat_t iv, lat;
+  LoadCell_GetStats(&iv, &lat);
+  double sps = (iv.count > 0 && iv.mean_us > 0.0) ? 1e6 / iv.mean_us : 0.0;
+  UART_Reply("{\"ok\":true,\"cmd\":\"get_loadcell_stats\",\"sps\":%.2f,\"samples_per_cycle\":%.2f,"
+              "\"interval_us\":[%lu,%lld,%.1f,%lld,%.1f],\"latency_us\":[%lu,%lld,%.1f,%lld,%.1f],\"queue_overruns\":%lu}\r\n",
+              sps, sps / MDR_CYCLE_FREQ_HZ,
+              (unsigned long)iv.count, (long long)(iv.count ? iv.min_us : 0), iv.mean_us, (long long)iv.max_us, hx711_stat_stddev(&iv),
+              (unsigned long)lat.count, (long long)(lat.count ? lat.min_us : 0), lat.mean_us, (long long)lat.max_us, hx711_stat_stddev(&lat),
+              (unsigned long)LoadCell_GetQueueOverruns());
+  if (arg[0].present && arg[0].num > 0) {
+    LoadCell_ResetStats();
+  }
+}
+
+static void cmd_set_phase_ref(const comm_val_t *arg)
+{
+  // Without "deg" the last fitted phase becomes zero (run an elastic reference sample first)
+  double deg = arg[0].present ? arg[0].num : g_run_analyzer.last_phase_deg;
+  if (deg < -360.0 || deg > 360.0) { reply_err("bad_args"); return; }
+  g_run_analyzer.phase_offset_deg = (float)deg;
+  UART_Reply("{\"ok\":true,\"cmd\":\"set_phase_ref\",\"deg\":%.3f}\r\n", deg);
+}
+
+static void cmd_set_filter(const comm_val_t *arg)
+{
+  const char *target = arg[0].str;
+  char spec[FILTER_SPEC_LEN];
+  filter_chain_t *chain = NULL;
+  if (strcmp(target, "raw") == 0) chain = LoadCell_GetRawFilter();
+  else if (strcmp(target, "run_amp") == 0) chain = cycle_analyzer_filter(&g_run_analyzer);
+  else if (strcmp(target, "idle_amp") == 0) chain = cycle_analyzer_filter(&g_idle_analyzer);
+  if (chain == NULL) { reply_err("bad_args"); return; }
+  // Without "spec" the current configuration is reported
+  if (arg[1].present && filter_chain_request(chain, arg[1].str) < 0) {
+    UART_Reply("{\"ok\":false,\"err\":\"bad_filter_spec\",\"max_stages\":%d,\"max_samples\":%d,\"max_rank_window\":%d}\r\n",
+               FILTER_MAX_STAGES, FILTER_POOL_SAMPLES, FILTER_MAX_RANK);
     return;
   }
-    
-  if (strcmp(cmd, "get_temp") == 0) {
-    float t1 = RTD_Temp_GetTemperature(1);
-    float t2 = RTD_Temp_GetTemperature(2);
-    UART_Printf("{\"t1\":%.2f,\"t2\":%.2f}\r\n", t1, t2);
-        return;
-    }
-    
-  if (strcmp(cmd, "set_mode") == 0) {
-    char val[16];
-    ESP_LOGI("UART", "val: %s", val);
-    if (find_key_str(line, "value", val, sizeof(val))) {
-      if (strcmp(val, "powerup") == 0) { mode = 0; relays_all_off(); reply_ok("set_mode"); return; }
-      if (strcmp(val, "idle") == 0)    { mode = 0; relays_all_off(); reply_ok("set_mode"); return; }
-      if (strcmp(val, "run") == 0)     { mode = 1; triggerFlg = 1; g_run_start_ms = (uint32_t)(xTaskGetTickCount()); reply_ok("set_mode"); return; }
-      if (strcmp(val, "stop") == 0)    { mode = 0; relays_all_off(); UART_Printf("{\"mode\":\"run\",\"status\":\"finished\"}\r\n"); return; }
-      if (strcmp(val, "calib") == 0)   { mode = 3; reply_ok("set_mode"); return; }
-    }
+  filter_chain_describe(chain, spec, sizeof(spec));
+  UART_Reply("{\"ok\":true,\"cmd\":\"set_filter\",\"target\":\"%s\",\"spec\":\"%s\"}\r\n", target, spec);
+}
+
+/* "run" or "idle" */
+static cycle_analyzer_t *cmd_analyzer(const char *target)
+{
+  if (strcmp(target, "run") == 0) return &g_run_analyzer;
+  if (strcmp(target, "idle") == 0) return &g_idle_analyzer;
+  return NULL;
+}
+
+static void cmd_set_window(const comm_val_t *arg)
+{
+  cycle_analyzer_t *ca = cmd_analyzer(arg[0].str);
+  if (ca == NULL) { reply_err("bad_args"); return; }
+  cycle_analyzer_set_window(ca, (uint8_t)arg[1].num);
+  UART_Reply("{\"ok\":true,\"cmd\":\"set_window\",\"target\":\"%s\",\"cycles\":%u}\r\n", arg[0].str, (unsigned)arg[1].num);
+}
+
+static void cmd_set_peak(const comm_val_t *arg)
+{
+  cycle_analyzer_t *ca = cmd_analyzer(arg[0].str);
+  const char *val = arg[1].str;
+  if (ca == NULL) { reply_err("bad_args"); return; }
+  if (strcmp(val, "sample") == 0) cycle_analyzer_set_peak_mode(ca, CYCLE_PEAK_SAMPLE);
+  else if (strcmp(val, "parabola") == 0) cycle_analyzer_set_peak_mode(ca, CYCLE_PEAK_PARABOLA);
+  else if (strcmp(val, "sine") == 0) cycle_analyzer_set_peak_mode(ca, CYCLE_PEAK_SINE);
+  else { reply_err("bad_args"); return; }
+  UART_Reply("{\"ok\":true,\"cmd\":\"set_peak\",\"target\":\"%s\",\"mode\":\"%s\"}\r\n", arg[0].str, val);
+}
+
+static void cmd_set_telemetry(const comm_val_t *arg)
+{
+  // The acknowledgement is always JSON: sent before switching to binary, after switching back
+  const char *val = arg[0].str;
+  if (strcmp(val, "binary") == 0) {
+    UART_Reply("{\"ok\":true,\"cmd\":\"set_telemetry\",\"format\":\"binary\"}\r\n");
+    Telemetry_SetFormat(TELEMETRY_BINARY);
+  } else if (strcmp(val, "json") == 0) {
+    Telemetry_SetFormat(TELEMETRY_JSON);
+    UART_Reply("{\"ok\":true,\"cmd\":\"set_telemetry\",\"format\":\"json\"}\r\n");
+  } else {
     reply_err("bad_args");
-        return;
+  }
+}
+
+static void cmd_get_stack(const comm_val_t *arg)
+{
+  (void)arg;
+  // Least free stack seen since start (bytes on ESP-IDF)
+  UART_Reply("{\"ok\":true,\"cmd\":\"get_stack\",\"comm_free\":%u,\"mode_free\":%u}\r\n",
+             (unsigned)uxTaskGetStackHighWaterMark(CommTaskHandle), (unsigned)uxTaskGetStackHighWaterMark(ModeTaskHandle));
+}
+
+static void cmd_get_tx_stats(const comm_val_t *arg)
+{
+  // One array entry per lane, in priority order
+  tx_ring_stats_t st[UART_TX_LANES];
+  for (uint8_t i = 0; i < UART_TX_LANES; i++) {
+    UartTx_GetStats((uart_tx_lane_t)i, &st[i]);
+  }
+#define TX_LANE_STAT(f) (unsigned long)st[0].f, (unsigned long)st[1].f, (unsigned long)st[2].f
+  UART_Reply("{\"ok\":true,\"cmd\":\"get_tx_stats\",\"lanes\":[\"response\",\"event\",\"bulk\"],"
+             "\"policy\":[\"%s\",\"%s\",\"%s\"],\"size\":[%lu,%lu,%lu],\"records\":[%lu,%lu,%lu],"
+             "\"dropped_newest\":[%lu,%lu,%lu],\"dropped_oldest\":[%lu,%lu,%lu],\"dropped_bytes\":[%lu,%lu,%lu],"
+             "\"high_water\":[%lu,%lu,%lu]}\r\n",
+             tx_policy_name(UART_TX_RESPONSE), tx_policy_name(UART_TX_EVENT), tx_policy_name(UART_TX_BULK),
+             (unsigned long)UartTx_GetSize(UART_TX_RESPONSE), (unsigned long)UartTx_GetSize(UART_TX_EVENT),
+             (unsigned long)UartTx_GetSize(UART_TX_BULK),
+             TX_LANE_STAT(records), TX_LANE_STAT(dropped_newest), TX_LANE_STAT(dropped_oldest),
+             TX_LANE_STAT(dropped_bytes), TX_LANE_STAT(high_water));
+#undef TX_LANE_STAT
+  if (arg[0].present && arg[0].num > 0) {
+    UartTx_ResetStats();
+  }
+}
+
+static void cmd_set_tx_policy(const comm_val_t *arg)
+{
+  const char *val = arg[0].str;
+  const char *lane_s = arg[1].present ? arg[1].str : "bulk";
+  uart_tx_lane_t lane;
+  tx_ring_policy_t policy;
+  if (strcmp(lane_s, "response") == 0)   lane = UART_TX_RESPONSE;
+  else if (strcmp(lane_s, "event") == 0) lane = UART_TX_EVENT;
+  else if (strcmp(lane_s, "bulk") == 0)  lane = UART_TX_BULK;
+  else { reply_err("bad_args"); return; }
+  if (strcmp(val, "drop_oldest") == 0)      policy = TX_DROP_OLDEST;
+  else if (strcmp(val, "drop_newest") == 0) policy = TX_DROP_NEWEST;
+  else { reply_err("bad_args"); return; }
+  UartTx_SetPolicy(lane, policy);
+  UART_Reply("{\"ok\":true,\"cmd\":\"set_tx_policy\",\"lane\":\"%s\",\"policy\":\"%s\"}\r\n", lane_s, val);
+}
+
+static void cmd_get_relays(const comm_val_t *arg)
+{
+  uint8_t relay1 = Relay_SSR_GetRelayState(1);
+  uint8_t relay2 = Relay_SSR_GetRelayState(2);
+  uint8_t relay3 = Relay_SSR_GetRelayState(3);
+  uint8_t relay4 = Relay_SSR_GetRelayState(4);
+  UART_Reply("{\"ok\":true,\"cmd\":\"get_relays\",\"relay1\":%d,\"relay2\":%d,\"relay3\":%d,\"relay4\":%d}\r\n",
+              relay1, relay2, relay3, relay4);
+}
+
+/* Argument schemas (handlers index arg[] in this order) */
+static const comm_arg_t rtd_calib_args[] = {
+  ARG_INT_IN("dev", ARG_REQ, 0, 255), ARG_NUM_IN("known", ARG_REQ, -ARG_HUGE, ARG_HUGE),
+};
+static const comm_arg_t set_temp_args[] = {
+  ARG_NUM_IN("value", ARG_REQ, -ARG_HUGE, ARG_HUGE),
+};
+static const comm_arg_t set_temp_rtd_args[] = {
+  ARG_INT_IN("dev", ARG_REQ, ARG_INT_MIN, ARG_INT_MAX), ARG_NUM_IN("temp", ARG_REQ, -ARG_HUGE, ARG_HUGE),
+};
+static const comm_arg_t set_mode_args[] = {
+  ARG_STR_MAX("value", ARG_REQ, 15),
+};
+static const comm_arg_t set_run_time_args[] = {
+  ARG_NUM_IN("seconds", ARG_REQ, 0, 4294967295.0),
+};
+static const comm_arg_t set_plateau_args[] = {
+  ARG_NUM_IN("slope", ARG_REQ, 0, ARG_HUGE), ARG_NUM_IN("window_s", ARG_OPT, 5, 300),
+};
+static const comm_arg_t set_sweep_args[] = {
+  ARG_LIST_IN("freqs", ARG_REQ, SWEEP_MIN_HZ, SWEEP_MAX_HZ, SWEEP_MAX_STEPS),
+  ARG_LIST_IN("dwell_s", ARG_REQ, 2, 3600, SWEEP_MAX_STEPS),
+};
+static const comm_arg_t calibrate_mdr_args[] = {
+  ARG_NUM_IN("weight", ARG_REQ, -ARG_HUGE, ARG_HUGE), ARG_NUM_IN("lever", ARG_REQ, -ARG_HUGE, ARG_HUGE),
+};
+static const comm_arg_t offset_mdr_args[] = {
+  ARG_NUM_IN("ms", ARG_OPT, 0, 4294967295.0),
+};
+static const comm_arg_t set_relay_args[] = {
+  ARG_INT_IN("relay", ARG_REQ, ARG_INT_MIN, ARG_INT_MAX), ARG_INT_IN("state", ARG_REQ, ARG_INT_MIN, ARG_INT_MAX),
+};
+static const comm_arg_t set_loadcell_gain_args[] = {
+  ARG_INT_IN("gain", ARG_REQ, ARG_INT_MIN, ARG_INT_MAX),
+};
+static const comm_arg_t set_loadcell_mux_args[] = {
+  ARG_INT_IN("ratio_a", ARG_REQ, 0, 1000), ARG_INT_IN("ratio_b", ARG_OPT, 1, 1000),
+};
+static const comm_arg_t set_loadcell_cal_args[] = {
+  ARG_INT_IN("ch", ARG_REQ, 0, 255), ARG_NUM_IN("offset", ARG_REQ, ARG_INT_MIN, ARG_INT_MAX), ARG_NUM_IN("coef", ARG_REQ, -ARG_HUGE, ARG_HUGE),
+};
+static const comm_arg_t tare_loadcell_args[] = {
+  ARG_INT_IN("ch", ARG_REQ, 0, 255),
+};
+static const comm_arg_t reset_args[] = {
+  ARG_NUM_IN("reset", ARG_OPT, -ARG_HUGE, ARG_HUGE),
+};
+static const comm_arg_t set_phase_ref_args[] = {
+  ARG_NUM_IN("deg", ARG_OPT, -360, 360),
+};
+static const comm_arg_t set_filter_args[] = {
+  ARG_STR_MAX("target", ARG_REQ, 15), ARG_STR_MAX("spec", ARG_OPT, FILTER_SPEC_LEN - 1),
+};
+static const comm_arg_t set_window_args[] = {
+  ARG_STR_MAX("target", ARG_REQ, 15), ARG_INT_IN("cycles", ARG_REQ, 1, CYCLE_ANALYZER_MAX_WINDOW),
+};
+static const comm_arg_t set_peak_args[] = {
+  ARG_STR_MAX("target", ARG_REQ, 15), ARG_STR_MAX("mode", ARG_REQ, 15),
+};
+static const comm_arg_t set_telemetry_args[] = {
+  ARG_STR_MAX("format", ARG_REQ, 15),
+};
+static const comm_arg_t set_tx_policy_args[] = {
+  ARG_STR_MAX("policy", ARG_REQ, 15), ARG_STR_MAX("lane", ARG_OPT, 15),
+};
+
+static const comm_cmd_t comm_cmds[] = {
+  COMM_CMD("rtd_calib", cmd_rtd_calib, rtd_calib_args),
+  COMM_CMD("set_temp", cmd_set_temp, set_temp_args),
+  COMM_CMD("set_temp_rtd", cmd_set_temp_rtd, set_temp_rtd_args),
+  COMM_CMD_NOARGS("get_temp", cmd_get_temp),
+  COMM_CMD("set_mode", cmd_set_mode, set_mode_args),
+  COMM_CMD("set_run_time", cmd_set_run_time, set_run_time_args),
+  COMM_CMD("set_plateau", cmd_set_plateau, set_plateau_args),
+  COMM_CMD("set_sweep", cmd_set_sweep, set_sweep_args),
+  COMM_CMD("calibrate_mdr", cmd_calibrate_mdr, calibrate_mdr_args),
+  COMM_CMD("offset_mdr", cmd_offset_mdr, offset_mdr_args),
+  COMM_CMD_NOARGS("tare_idle_amp", cmd_tare_idle_amp),
+  COMM_CMD("set_relay", cmd_set_relay, set_relay_args),
+  COMM_CMD("set_loadcell_gain", cmd_set_loadcell_gain, set_loadcell_gain_args),
+  COMM_CMD("set_loadcell_mux", cmd_set_loadcell_mux, set_loadcell_mux_args),
+  COMM_CMD_NOARGS("get_loadcell_b", cmd_get_loadcell_b),
+  COMM_CMD_NOARGS("get_loadcells", cmd_get_loadcells),
+  COMM_CMD("set_loadcell_cal", cmd_set_loadcell_cal, set_loadcell_cal_args),
+  COMM_CMD("tare_loadcell", cmd_tare_loadcell, tare_loadcell_args),
+  COMM_CMD("get_loadcell_stats", cmd_get_loadcell_stats, reset_args),
+  COMM_CMD("set_phase_ref", cmd_set_phase_ref, set_phase_ref_args),
+  COMM_CMD("set_filter", cmd_set_filter, set_filter_args),
+  COMM_CMD("set_window", cmd_set_window, set_window_args),
+  COMM_CMD("set_peak", cmd_set_peak, set_peak_args),
+  COMM_CMD("set_telemetry", cmd_set_telemetry, set_telemetry_args),
+  COMM_CMD("get_tx_stats", cmd_get_tx_stats, reset_args),
+  COMM_CMD("set_tx_policy", cmd_set_tx_policy, set_tx_policy_args),
+  COMM_CMD_NOARGS("get_relays", cmd_get_relays),
+  COMM_CMD_NOARGS("get_stack", cmd_get_stack),
+};
+
+/* Same hash as COMM_HASH() for a name that is not NUL-terminated */
+static uint32_t comm_hash(const char *name, size_t len)
+{
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < COMM_NAME_MAX; i++) {
+    h = (h ^ (i < len ? (uint8_t)name[i] : 0u)) * 16777619u;
+  }
+  return h;
+}
+
+static const comm_cmd_t *comm_find(const char *name, size_t len)
+{
+  uint32_t h = comm_hash(name, len);
+  for (size_t i = 0; i < sizeof(comm_cmds) / sizeof(comm_cmds[0]); i++) {
+    const comm_cmd_t *c = &comm_cmds[i];
+    if (c->hash == h && strncmp(c->name, name, len) == 0 && c->name[len] == '\0') {
+      return c;
     }
-    
-  if (strcmp(cmd, "set_run_time") == 0) {
-    double sec = 0;
-    if (find_key_num(line, "seconds", &sec) && sec > 0) {
-      g_run_time_s = (uint32_t)sec;
-      UART_Printf("set_run_time: %u seconds\r\n", (uint32_t)sec);
-      offTime = (uint32_t)sec; // Also update legacy variable for compatibility
-      reply_ok("set_run_time");
-    } else {
-      reply_err("bad_args");
+  }
+  return NULL;
+}
+
+/* Check one value against its schema entry and store it; 0 if it does not conform */
+static uint8_t comm_bind(const comm_arg_t *a, const json_doc_t *doc, const json_value_t *v, comm_val_t *out)
+{
+  switch (a->type) {
+  case ARG_NUM:
+  case ARG_INT:
+    if (v->type != JSON_NUMBER || v->num < a->min || v->num > a->max ||
+        (a->type == ARG_INT && v->num != floor(v->num))) {
+      return 0;
     }
-        return;
+    out->num = v->num;
+    break;
+  case ARG_STR:
+    if (v->type != JSON_STRING || v->escaped || v->len > a->count) {
+      return 0;
     }
-    
-  if (strcmp(cmd, "calibrate_mdr") == 0) {
-    double w=0, lever=0;
-    if (find_key_num(line, "weight", &w) && find_key_num(line, "lever", &lever) && w>0 && lever>0) {
-      compute_offset_over_ms(60000);
-      relays_sequence_on();
-      float T_cal = (float)(w * 9.81 * lever);
-      compute_KT_over_ms(60000, T_cal);
-      relays_all_off();
-      
-      // Save MDR calibration to EEPROM
-      if (EEPROM_SaveMDRCalibration(g_ADC_zero, g_K_T) == ESP_OK) {
-        UART_Printf("Saved MDR calibration to EEPROM\r\n");
-      } else {
-        UART_Printf("Failed to save MDR calibration to EEPROM\r\n");
-      }
-      
-      UART_Printf("{\"ok\":true,\"cmd\":\"calibrate_mdr\",\"ADC_zero\":%.3f,\"K_T\":%.9f}\r\n", g_ADC_zero, g_K_T);
+    out->str = v->str;
+    out->count = (uint8_t)v->len;
+    break;
+  case ARG_NUM_LIST:
+    if (v->type == JSON_NUMBER) {
+      out->list = v;
+      out->count = 1;
+    } else if (v->type == JSON_ARRAY && v->len >= 1 && v->len <= a->count) {
+      out->list = &doc->elem[v->first];
+      out->count = (uint8_t)v->len;
     } else {
-      reply_err("bad_args");
-    }
-        return;
+      return 0;
     }
-
-  if (strcmp(cmd, "offset_mdr") == 0) {
-    double ms = 5000;
-    (void)find_key_num(line, "ms", &ms);
-    relays_all_off();
-    compute_offset_over_ms((uint32_t)ms);
-    
-    // Save MDR offset to EEPROM
-    if (EEPROM_SaveMDRCalibration(g_ADC_zero, g_K_T) == ESP_OK) {
-      UART_Printf("Saved MDR offset to EEPROM\r\n");
-    } else {
-      UART_Printf("Failed to save MDR offset to EEPROM\r\n");
+    for (uint8_t i = 0; i < out->count; i++) {
+      if (out->list[i].type != JSON_NUMBER || out->list[i].num < a->min || out->list[i].num > a->max) {
+        return 0;
+      }
     }
-    
-    UART_Printf("{\"ok\":true,\"cmd\":\"offset_mdr\",\"ADC_zero\":%.3f}\r\n", g_ADC_zero);
-    return;
+    break;
   }
+  out->present = 1;
+  return 1;
+}
 
-  if (strcmp(cmd, "tare_idle_amp") == 0) {
-    // This command will be handled by setting a flag that the ModeTask will read
-    // We'll use a global variable to communicate between CommTask and ModeTask
-    extern double g_idle_amp_tare_request;
-    g_idle_amp_tare_request = 1.0; // Set flag to request tare
-    reply_ok("tare_idle_amp");
+/**
+  * @brief Parse and execute one command line
+  * @param line: Line without its terminator; string arguments are NUL-terminated in place
+  * @param len: Bytes in line
+  * @retval None
+  */
+static void handle_line(char *line, size_t len)
+{
+  static json_doc_t doc;          // CommTask only; kept off its stack
+  comm_val_t arg[COMM_MAX_ARGS];
+
+  ESP_LOGD("UART", "Received %.*s", (int)len, line);
+  json_err_t err = json_parse(&doc, line, len);
+  if (err != JSON_OK) {
+    UART_Reply("{\"ok\":false,\"err\":\"bad_json\",\"at\":%u}\r\n", (unsigned)doc.err_pos);
     return;
   }
+  const json_value_t *name = json_get(&doc, "cmd");
+  if (name == NULL || name->type != JSON_STRING || name->escaped) { reply_err("bad_json"); return; }
+  const comm_cmd_t *cmd = comm_find(name->str, name->len);
+  if (cmd == NULL) { reply_err("unknown_cmd"); return; }
 
-  if (strcmp(cmd, "set_relay") == 0) {
-    double relay_num = 0, state = 0;
-    if (find_key_num(line, "relay", &relay_num) && find_key_num(line, "state", &state)) {
-      int relay = (int)relay_num;
-      int relay_state = (int)state;
-      
-      // Validate relay number (1-4) and state (0-1)
-      if (relay >= 1 && relay <= 4 && (relay_state == 0 || relay_state == 1)) {
-        Relay_SSR_SetRelay((uint8_t)relay, (uint8_t)relay_state);
-        UART_Printf("{\"ok\":true,\"cmd\":\"set_relay\",\"relay\":%d,\"state\":%d}\r\n", relay, relay_state);
-      } else {
-        reply_err("invalid_relay_or_state");
-      }
-    } else {
-      reply_err("bad_args");
+  memset(arg, 0, sizeof(arg));
+  for (uint8_t m = 0; m < doc.members; m++) {
+    const json_member_t *mb = &doc.member[m];
+    if (&mb->val == name) continue;
+    uint8_t i = 0;
+    while (i < cmd->nargs && !(strncmp(cmd->args[i].key, mb->key, mb->key_len) == 0 && cmd->args[i].key[mb->key_len] == '\0')) {
+      i++;
+    }
+    if (i == cmd->nargs || !comm_bind(&cmd->args[i], &doc, &mb->val, &arg[i])) {
+      reply_err_arg(mb->key, mb->key_len);
+      return;
     }
-    return;
   }
-
-  if (strcmp(cmd, "get_relays") == 0) {
-    uint8_t relay1 = Relay_SSR_GetRelayState(1);
-    uint8_t relay2 = Relay_SSR_GetRelayState(2);
-    uint8_t relay3 = Relay_SSR_GetRelayState(3);
-    uint8_t relay4 = Relay_SSR_GetRelayState(4);
-    UART_Printf("{\"ok\":true,\"cmd\":\"get_relays\",\"relay1\":%d,\"relay2\":%d,\"relay3\":%d,\"relay4\":%d}\r\n", 
-                relay1, relay2, relay3, relay4);
-    return;
+  for (uint8_t i = 0; i < cmd->nargs; i++) {
+    if (cmd->args[i].required && !arg[i].present) {
+      reply_err_arg(cmd->args[i].key, strlen(cmd->args[i].key));
+      return;
+    }
+  }
+  // Validated: terminate string arguments over their closing quotes
+  for (uint8_t i = 0; i < cmd->nargs; i++) {
+    if (arg[i].present && cmd->args[i].type == ARG_STR) {
+      line[(arg[i].str - line) + arg[i].count] = '\0';
+    }
   }
-    
-  reply_err("unknown_cmd");
+  cmd->handler(arg);
 }
 
-static void uart_poll_and_process_lines(void)
+// Line being assembled by comm_feed
+static char comm_line[COMM_LINEBUF_SIZE];
+static size_t comm_line_len;
+
+/* Split received bytes into lines ('\r' ignored, overlong lines truncated) */
+static void comm_feed(const uint8_t *data, size_t len)
 {
-  uint8_t rxbuf[COMM_RXBUF_SIZE];
-  static char line[COMM_LINEBUF_SIZE];
-  static size_t line_len;
-
-  int len = uart_read_bytes(COMM_UART, rxbuf, sizeof(rxbuf), pdMS_TO_TICKS(20));
-  if (len <= 0) return;
-  ESP_LOGI("UART", "Received %d bytes", len);
-  ESP_LOGI("UART", "Received %s", rxbuf);
-  for (int i = 0; i < len; i++) {
-    char ch = (char)rxbuf[i];
+  for (size_t i = 0; i < len; i++) {
+    char ch = (char)data[i];
     if (ch == '\r') continue;
     if (ch == '\n') {
-      line[line_len] = '\0';
-      if (line_len > 0) handle_line(line);
-      line_len = 0;
-    } else if (line_len < sizeof(line) - 1) {
-      line[line_len++] = ch;
+      comm_line[comm_line_len] = '\0';
+      if (comm_line_len > 0) handle_line(comm_line, comm_line_len);
+      comm_line_len = 0;
+    } else if (comm_line_len < sizeof(comm_line) - 1) {
+      comm_line[comm_line_len++] = ch;
     }
   }
 }
 
+/* Move len buffered bytes from the driver into the line splitter */
+static void comm_read(size_t len)
+{
+  uint8_t rxbuf[COMM_RXBUF_SIZE];
+  while (len > 0) {
+    int n = uart_read_bytes(COMM_UART, rxbuf, (len < sizeof(rxbuf)) ? len : sizeof(rxbuf), 0);
+    if (n <= 0) break;
+    comm_feed(rxbuf, (size_t)n);
+    len -= (size_t)n;
+  }
+}
+
+/**
+  * @brief Command task: sleeps on the UART event queue, handles each line as its '\n' arrives
+  * @param argument: Not used
+  * @retval None
+  */
 static void CommTask_Function(void *argument)
 {
+  uart_event_t event;
   for(;;) {
-    uart_poll_and_process_lines();
-    vTaskDelay(pdMS_TO_TICKS(10));
+    if (xQueueReceive(CommUartQueue, &event, portMAX_DELAY) != pdTRUE) continue;
+    switch (event.type) {
+    case UART_PATTERN_DET: {
+      // Position of the '\n' in the RX buffer; -1 if the pattern queue overflowed
+      int pos = uart_pattern_pop_pos(COMM_UART);
+      if (pos >= 0) {
+        comm_read((size_t)pos + 1);
+      } else {
+        size_t buffered = 0;
+        uart_get_buffered_data_len(COMM_UART, &buffered);
+        comm_read(buffered);
+        uart_pattern_queue_reset(COMM_UART, COMM_PATTERN_QUEUE);
+      }
+      break;
+    }
+    case UART_FIFO_OVF:
+    case UART_BUFFER_FULL:
+      // Bytes were lost: discard the buffered input and the partial line
+      uart_flush_input(COMM_UART);
+      xQueueReset(CommUartQueue);
+      uart_pattern_queue_reset(COMM_UART, COMM_PATTERN_QUEUE);
+      comm_line_len = 0;
+      break;
+    default:
+      // UART_DATA: bytes of a line still in progress stay buffered until its '\n'
+      break;
+    }
   }
 }
 
 static void ModeTask_Function(void *argument)
 {
   int last_mode = -1;
-  uint32_t last_broadcast = 0;
   uint32_t last_print = 0;
-  // Cycle amplitude tracking (per MDR reference)
-  const float cycle_freq_hz = 1.66f; // default
-  const uint32_t cycle_period_ms = (uint32_t)(1000.0f / cycle_freq_hz + 0.5f); // ≈602 ms
-  const TickType_t cycle_period_ticks = pdMS_TO_TICKS(cycle_period_ms);
-  uint32_t cycle_start_ms = 0;
-  double cycle_tmin = 1e300, cycle_tmax = -1e300;
+  LoadCell_Sample_t sample = {0}; // last conversion consumed
+  // Cycle amplitude tracking (per MDR reference): boundaries locked to the
+  // measured oscillation, MDR_CYCLE_FREQ_HZ is only the expected frequency
+  cycle_window_t cycle;
   int run_started = 0;
-  
-  // Moving average filter for amplitude (5-window)
-  double amp_filter_buffer[5] = {0.0, 0.0, 0.0, 0.0, 0.0};
-  int amp_filter_index = 0;
-  int amp_filter_count = 0;
-  
-  // Amplitude tracking for idle mode
-  const uint32_t idle_cycle_period_ms = (uint32_t)(1000.0f / cycle_freq_hz + 0.5f); // Same as run mode: ≈602 ms
-  const TickType_t idle_cycle_period_ticks = pdMS_TO_TICKS(idle_cycle_period_ms);
-  uint32_t idle_cycle_start_ms = 0;
-  double idle_tmin = 1e300, idle_tmax = -1e300;
-  
-  // Moving average filter for idle mode amplitude (2-window)
-  double idle_amp_filter_buffer[2] = {0.0, 0.0};
-  int idle_amp_filter_index = 0;
-  int idle_amp_filter_count = 0;
+  int64_t run_t0_us = -1;   // timestamp of the first sample of the run
   
   // Idle mode amplitude offset/tare value
   double idle_amp_offset = 0.0;
@@ -427,19 +1052,16 @@ static void ModeTask_Function(void *argument)
       if (current_mode == 0) { // idle/stop
         relays_all_off();
         // Reset idle mode amplitude tracking
-        idle_cycle_start_ms = (uint32_t)xTaskGetTickCount();
-        idle_tmin = 1e300; idle_tmax = -1e300;
-        idle_amp_filter_buffer[0] = 0.0; idle_amp_filter_buffer[1] = 0.0;
-        idle_amp_filter_index = 0; idle_amp_filter_count = 0;
+        cycle_analyzer_reset(&g_idle_analyzer);
+        LoadCell_FlushSamples();
         // Note: idle_amp_offset is preserved across mode transitions
       } else if (current_mode == 1) { // run
         // Prepare run: relays sequencing will be done just before starting timer
         offTime = g_run_time_s; // keep legacy var in sync (seconds)
         run_started = 0;
-        cycle_tmin = 1e300; cycle_tmax = -1e300;
-        // Reset moving average filter
-        amp_filter_buffer[0] = 0.0; amp_filter_buffer[1] = 0.0; amp_filter_buffer[2] = 0.0; amp_filter_buffer[3] = 0.0; amp_filter_buffer[4] = 0.0;
-        amp_filter_index = 0; amp_filter_count = 0;
+        cycle_analyzer_set_nominal(&g_run_analyzer, MDR_CYCLE_FREQ_HZ); // a sweep may have retuned it
+      } else if (current_mode == 2) { // sweep
+        run_started = 0;
       } else if (current_mode == 3) { // calibration mode (idle here)
         relays_all_off();
         run_started = 0;
@@ -451,83 +1073,61 @@ static void ModeTask_Function(void *argument)
     if (current_mode == 0) { // idle mode
       // Check for idle amplitude tare request
       if (g_idle_amp_tare_request > 0.0) {
-        // Calculate current filtered amplitude
-        double current_amp = 0.0;
-        if (idle_amp_filter_count > 0) {
-          double sum = 0.0;
-          for (int i = 0; i < idle_amp_filter_count; i++) {
-            sum += idle_amp_filter_buffer[i];
-          }
-          current_amp = sum / (double)idle_amp_filter_count;
-        }
+        // Live amplitude over the last period (sliding DFT), not the last window
+        double current_amp = cycle_analyzer_live(&g_idle_analyzer);
         
         // Set offset to current amplitude value
         idle_amp_offset = current_amp;
         g_idle_amp_tare_request = 0.0; // Clear request flag
         
-        UART_Printf("{\"ok\":true,\"cmd\":\"tare_idle_amp\",\"offset\":%.6f}\r\n", (float)idle_amp_offset);
+        UART_Reply("{\"ok\":true,\"cmd\":\"tare_idle_amp\",\"offset\":%.6f}\r\n", (float)idle_amp_offset);
       }
       
-      // Broadcast torque at ~100 Hz in idle mode
-      if ((uint32_t)(xTaskGetTickCount()) - last_broadcast >= pdMS_TO_TICKS(10)) {
-        last_broadcast = (uint32_t)(xTaskGetTickCount());
-        int32_t raw = LoadCell_GetRaw();
-        float torque = (g_K_T > 0.0f) ? (float)((double)raw - (double)g_ADC_zero) * g_K_T : 0.0f;
-        
-        // Update idle mode amplitude tracking
-        double t = (double)torque;
-        if (t < idle_tmin) idle_tmin = t;
-        if (t > idle_tmax) idle_tmax = t;
-      }
-      
-      // Print idle mode data at 10Hz
-      if ((uint32_t)(xTaskGetTickCount()) - last_print >= pdMS_TO_TICKS(100)) {
-        last_print = (uint32_t)(xTaskGetTickCount());
-        UART_Printf("{\"mode\":\"idle\",\"raw\":%ld,\"torque\":%.6f}\r\n", (long)LoadCell_GetRaw(), (g_K_T > 0.0f) ? (float)((double)LoadCell_GetRaw() - (double)g_ADC_zero) * g_K_T : 0.0f);
-      }
-      
-      // When idle cycle elapses, compute and print amplitude
-      TickType_t now_ticks_idle = xTaskGetTickCount();
-      if ((now_ticks_idle - (TickType_t)idle_cycle_start_ms) >= idle_cycle_period_ticks) {
-        double amp = (idle_tmax - idle_tmin) / 2.0;
-        
-        // Apply 2-window moving average filter
-        idle_amp_filter_buffer[idle_amp_filter_index] = amp;
-        idle_amp_filter_index = (idle_amp_filter_index + 1) % 2;
-        if (idle_amp_filter_count < 2) idle_amp_filter_count++;
-        
-        // Calculate filtered amplitude
-        double filtered_amp = 0.0;
-        if (idle_amp_filter_count > 0) {
-          double sum = 0.0;
-          for (int i = 0; i < idle_amp_filter_count; i++) {
-            sum += idle_amp_filter_buffer[i];
-          }
-          filtered_amp = sum / (double)idle_amp_filter_count;
+      // Every conversion since the last pass, once each and in order
+      while (LoadCell_PopSample(&sample)) {
+        // Update idle mode amplitude tracking; continue until a window completes
+        double t = (double)mdr_torque(sample.raw);
+        uint8_t window_done = cycle_analyzer_feed(&g_idle_analyzer, sample.timestamp_us, t, &cycle);
+        if (mdr_binary()) {
+          mdr_send_sample(TELEMETRY_MODE_IDLE, &sample, t, cycle_analyzer_live(&g_idle_analyzer) - idle_amp_offset);
+        }
+        if (!window_done) {
+          continue;
         }
+        double amp = cycle.amp;
+        double filtered_amp = cycle.amp_filtered;
         
         // Apply offset to filtered amplitude
         double offset_amp = filtered_amp - idle_amp_offset;
         
         // Print filtered amplitude with offset applied
-        if(filtered_amp > 0.0) {
-           UART_Printf("{\"mode\":\"idle\",\"cycle_amp\":%.6f,\"cycle_amp_filtered\":%.6f,\"cycle_amp_offset\":%.6f,\"min\":%.6f,\"max\":%.6f}\r\n", 
-                   (float)amp, (float)offset_amp, (float)idle_amp_offset, (float)idle_tmin, (float)idle_tmax);
+        if (mdr_binary()) {
+          mdr_send_cycle(TELEMETRY_MODE_IDLE, 0, &cycle, offset_amp);
+        }
+        else if(filtered_amp > 0.0) {
+           UART_Stream("{\"mode\":\"idle\",\"cycle_amp\":%.6f,\"cycle_amp_filtered\":%.6f,\"cycle_amp_offset\":%.6f,\"min\":%.6f,\"max\":%.6f,\"freq_hz\":%.4f,\"locked\":%d}\r\n", 
+                   (float)amp, (float)offset_amp, (float)idle_amp_offset, (float)cycle.min, (float)cycle.max, cycle.freq_hz, cycle.locked);
         }
         else {
-          UART_Printf("{\"mode\":\"idle\",\"cycle_amp\":1.0,\"cycle_amp_filtered\":1.0,\"cycle_amp_offset\":%.6f,\"min\":%.6f,\"max\":%.6f}\r\n", (float)idle_amp_offset, (float)idle_tmin, (float)idle_tmax);
+          UART_Stream("{\"mode\":\"idle\",\"cycle_amp\":1.0,\"cycle_amp_filtered\":1.0,\"cycle_amp_offset\":%.6f,\"min\":%.6f,\"max\":%.6f,\"freq_hz\":%.4f,\"locked\":%d}\r\n", (float)idle_amp_offset, (float)cycle.min, (float)cycle.max, cycle.freq_hz, cycle.locked);
         }
-        
-        // Advance to next cycle window
-        idle_cycle_start_ms = (uint32_t)now_ticks_idle;
-        idle_tmin = 1e300; idle_tmax = -1e300;
+      }
+      
+      // Print idle mode data at 10Hz (binary telemetry sends every sample instead)
+      if (!mdr_binary() && (uint32_t)(xTaskGetTickCount()) - last_print >= pdMS_TO_TICKS(100)) {
+        last_print = (uint32_t)(xTaskGetTickCount());
+        double amp_live = cycle_analyzer_live(&g_idle_analyzer);
+        UART_Stream("{\"mode\":\"idle\",\"raw\":%ld,\"torque\":%.6f,\"amp_live\":%.6f,\"amp_live_offset\":%.6f}\r\n",
+                    (long)sample.raw, mdr_torque(sample.raw), (float)amp_live, (float)(amp_live - idle_amp_offset));
       }
     } else if (current_mode == 1) { // run mode
       // If not started, sequence relays then start the timer
       if (!run_started) {
         relays_sequence_on();
+        LoadCell_FlushSamples(); // samples queued while the relays were sequencing
+        cure_run_start(&g_cure_run, g_plateau_slope, g_plateau_window_s);
+        run_t0_us = -1;
         g_run_start_ms = (uint32_t)xTaskGetTickCount();
-        cycle_start_ms = g_run_start_ms;
         run_started = 1;
       }
 
@@ -540,64 +1140,127 @@ static void ModeTask_Function(void *argument)
         offTime = g_run_time_s - elapsed_s;
       }
 
-      // Broadcast torque at ~100 Hz
-      if ((uint32_t)(xTaskGetTickCount()) - last_broadcast >= pdMS_TO_TICKS(10)) {
-        last_broadcast = (uint32_t)(xTaskGetTickCount());
-        int32_t raw = LoadCell_GetRaw();
-        float torque = (g_K_T > 0.0f) ? (float)((double)raw - (double)g_ADC_zero) * g_K_T : 0.0f;
-        // Update cycle min/max for amplitude
-        double t = (double)torque;
-        if (t < cycle_tmin) cycle_tmin = t;
-        if (t > cycle_tmax) cycle_tmax = t;
-      }
-      
-      // Print run mode data at 10Hz
-      if ((uint32_t)(xTaskGetTickCount()) - last_print >= pdMS_TO_TICKS(10)) {
-        last_print = (uint32_t)(xTaskGetTickCount());
-        UART_Printf("{\"mode\":\"run\",\"elapsed_s\":%u,\"raw\":%ld,\"torque\":%.6f}\r\n", (unsigned)elapsed_s, (long)LoadCell_GetRaw(), (g_K_T > 0.0f) ? (float)((double)LoadCell_GetRaw() - (double)g_ADC_zero) * g_K_T : 0.0f);
-      }
-
-      // When a cycle elapses (tick-based), compute and print amplitude
-      TickType_t now_ticks2 = xTaskGetTickCount();
-      if ((now_ticks2 - (TickType_t)cycle_start_ms) >= cycle_period_ticks) {
-        double amp = (cycle_tmax - cycle_tmin) / 2.0;
-        
-        // Apply 5-window moving average filter
-        amp_filter_buffer[amp_filter_index] = amp;
-        amp_filter_index = (amp_filter_index + 1) % 5;
-        if (amp_filter_count < 5) amp_filter_count++;
+      // Every conversion since the last pass, once each and in order
+      while (LoadCell_PopSample(&sample)) {
+        if (run_t0_us < 0) run_t0_us = sample.timestamp_us;
+        // Update run amplitude tracking; continue until a window completes
+        double t = (double)mdr_torque(sample.raw);
+        uint8_t window_done = cycle_analyzer_feed(&g_run_analyzer, sample.timestamp_us, t, &cycle);
+        if (mdr_binary()) {
+          mdr_send_sample(TELEMETRY_MODE_RUN, &sample, t, cycle_analyzer_live(&g_run_analyzer));
+        }
+        if (!window_done) {
+          continue;
+        }
+        double filtered_amp = cycle.amp_filtered;
         
-        // Calculate filtered amplitude
-        double filtered_amp = 0.0;
-        if (amp_filter_count > 0) {
-          double sum = 0.0;
-          for (int i = 0; i < amp_filter_count; i++) {
-            sum += amp_filter_buffer[i];
-          }
-          filtered_amp = sum / (double)amp_filter_count;
+        // Cure curve point at the middle of the cycle; plateau and model fit from ts2 on,
+        // predicted MH/t90 with approximate 95 % bounds each cycle (t90 observed once reached)
+        float cycle_t_s = (float)((double)(cycle.start_us + cycle.period_us / 2 - run_t0_us) / 1e6);
+        cure_fit_result_t fr;
+        uint8_t fit_ok = cure_run_add(&g_cure_run, cycle_t_s, filtered_amp, &fr);
+        if (fit_ok && mdr_binary()) {
+          const telemetry_fit_t rec = {
+            .mh = (float)fr.mh, .mh_ci_lo = (float)fr.mh_ci_lo, .mh_ci_hi = (float)fr.mh_ci_hi, .k = (float)fr.k,
+            .t90 = fr.t90, .t90_ci_lo = fr.t90_ci_lo, .t90_ci_hi = fr.t90_ci_hi, .points = (uint16_t)fr.points,
+          };
+          Telemetry_SendFit(&rec);
+        } else if (fit_ok) {
+          UART_Stream("{\"mode\":\"run\",\"fit\":{\"mh\":%.6f,\"mh_ci_lo\":%.6f,\"mh_ci_hi\":%.6f,\"k\":%.6f,"
+                      "\"t90\":%.1f,\"t90_ci_lo\":%.1f,\"t90_ci_hi\":%.1f,\"rho\":%.3f,\"rms\":%.6f,\"points\":%u}}\r\n",
+                      fr.mh, fr.mh_ci_lo, fr.mh_ci_hi, fr.k, fr.t90, fr.t90_ci_lo, fr.t90_ci_hi, fr.rho, fr.rms, (unsigned)fr.points);
         }
         
         // Print filtered amplitude
+        if (mdr_binary()) {
+          mdr_send_cycle(TELEMETRY_MODE_RUN, 0, &cycle, filtered_amp);
+          continue;
+        }
+        char quad[320];
+        mdr_format_quad(&g_run_analyzer, &cycle, quad, sizeof(quad));
         if(filtered_amp > 0.0) {
-           UART_Printf("{\"mode\":\"run\",\"cycle_amp\":%.6f,\"cycle_amp_filtered\":%.6f,\"min\":%.6f,\"max\":%.6f}\r\n", 
-                   (float)filtered_amp, (float)filtered_amp, (float)cycle_tmin, (float)cycle_tmax);
+           UART_Stream("{\"mode\":\"run\",\"cycle_amp\":%.6f,\"cycle_amp_filtered\":%.6f,\"min\":%.6f,\"max\":%.6f,\"freq_hz\":%.4f,\"locked\":%d%s}\r\n", 
+                   (float)filtered_amp, (float)filtered_amp, (float)cycle.min, (float)cycle.max, cycle.freq_hz, cycle.locked, quad);
         }
         else {
-          UART_Printf("{\"mode\":\"run\",\"cycle_amp\":1.0,\"cycle_amp_filtered\":1.0,\"min\":%.6f,\"max\":%.6f}\r\n", (float)cycle_tmin, (float)cycle_tmax);
+          UART_Stream("{\"mode\":\"run\",\"cycle_amp\":1.0,\"cycle_amp_filtered\":1.0,\"min\":%.6f,\"max\":%.6f,\"freq_hz\":%.4f,\"locked\":%d%s}\r\n", (float)cycle.min, (float)cycle.max, cycle.freq_hz, cycle.locked, quad);
         }
-        
-        // Advance to next cycle window
-        cycle_start_ms = (uint32_t)now_ticks2;
-        cycle_tmin = 1e300; cycle_tmax = -1e300;
+      }
+      
+      // Print run mode data at 10Hz (binary telemetry sends every sample instead)
+      if (!mdr_binary() && (uint32_t)(xTaskGetTickCount()) - last_print >= pdMS_TO_TICKS(10)) {
+        last_print = (uint32_t)(xTaskGetTickCount());
+        UART_Stream("{\"mode\":\"run\",\"elapsed_s\":%u,\"raw\":%ld,\"torque\":%.6f,\"amp_live\":%.6f}\r\n",
+                    (unsigned)elapsed_s, (long)sample.raw, mdr_torque(sample.raw), (float)cycle_analyzer_live(&g_run_analyzer));
       }
 
       // Stop condition
-      if (elapsed_s >= g_run_time_s) {
-        UART_Printf("{\"mode\":\"run\",\"status\":\"finished\"}\r\n");
+      float plateau_end_s = g_cure_run.end_s;
+      if (elapsed_s >= g_run_time_s || plateau_end_s >= 0.0f) {
+        cure_result_t cr;
+        cure_curve_result(&g_cure_run.curve, &cr);
+        UART_Printf("{\"mode\":\"run\",\"status\":\"finished\",\"end\":\"%s\",\"t_end\":%.1f,\"ml\":%.6f,\"mh\":%.6f,\"t_ml\":%.1f,\"t_mh\":%.1f,"
+                    "\"ts1\":%.1f,\"ts2\":%.1f,\"t10\":%.1f,\"t50\":%.1f,\"t90\":%.1f}\r\n",
+                    (plateau_end_s >= 0.0f) ? "plateau" : "time", (plateau_end_s >= 0.0f) ? plateau_end_s : (float)elapsed_s,
+                    cr.ml, cr.mh, cr.t_ml, cr.t_mh, cr.ts1, cr.ts2, cr.t10, cr.t50, cr.t90);
         mode = 0; // stop -> idle
         relays_all_off();
         run_started = 0;
       }
+    } else if (current_mode == 2) { // frequency sweep
+      // Same start-up as a run, then step through the plan retuning the run analyzer
+      if (!run_started) {
+        relays_sequence_on();
+        LoadCell_FlushSamples();
+        g_run_start_ms = (uint32_t)xTaskGetTickCount();
+        sweep_start(&g_sweep, g_sweep_plan, g_sweep_steps, 0.0f);
+        run_t0_us = -1;
+        const sweep_step_t *st = sweep_current(&g_sweep);
+        cycle_analyzer_set_nominal(&g_run_analyzer, st->freq_hz);
+        UART_Printf("{\"mode\":\"sweep\",\"step\":0,\"freq_hz\":%.3f,\"dwell_s\":%.1f}\r\n", st->freq_hz, st->dwell_s);
+        run_started = 1;
+      }
+      
+      // Samples are taken in order on their own clock, so everything converted before a
+      // step boundary has gone to the old step when it is closed and the analyzer retuned
+      while (!sweep_done(&g_sweep) && LoadCell_PopSample(&sample)) {
+        if (run_t0_us < 0) run_t0_us = sample.timestamp_us;
+        int done = sweep_poll(&g_sweep, (float)((double)(sample.timestamp_us - run_t0_us) / 1e6));
+        if (done >= 0) {
+          mdr_sweep_step(done);
+          if (sweep_done(&g_sweep)) {
+            break;
+          }
+        }
+        double t = (double)mdr_torque(sample.raw);
+        uint8_t window_done = cycle_analyzer_feed(&g_run_analyzer, sample.timestamp_us, t, &cycle);
+        if (mdr_binary()) {
+          mdr_send_sample(TELEMETRY_MODE_SWEEP, &sample, t, cycle_analyzer_live(&g_run_analyzer));
+        }
+        if (!window_done) {
+          continue;
+        }
+        // Window start on the sweep clock; the first conversion is within a sample period of its zero
+        sweep_add(&g_sweep, (float)((double)(cycle.start_us - run_t0_us) / 1e6), &cycle);
+        if (mdr_binary()) {
+          mdr_send_cycle(TELEMETRY_MODE_SWEEP, g_sweep.index, &cycle, cycle.amp_filtered);
+          continue;
+        }
+        char quad[320];
+        mdr_format_quad(&g_run_analyzer, &cycle, quad, sizeof(quad));
+        UART_Stream("{\"mode\":\"sweep\",\"step\":%u,\"cycle_amp\":%.6f,\"min\":%.6f,\"max\":%.6f,\"freq_hz\":%.4f,\"locked\":%d%s}\r\n",
+                    (unsigned)g_sweep.index, (float)cycle.amp, (float)cycle.min, (float)cycle.max, cycle.freq_hz, cycle.locked, quad);
+      }
+      
+      if (sweep_done(&g_sweep)) {
+        UART_Printf("{\"mode\":\"sweep\",\"status\":\"finished\",\"points\":%u}\r\n", (unsigned)g_sweep.steps);
+        mode = 0; // stop -> idle
+        relays_all_off();
+        run_started = 0;
+      }
+    } else {
+      // No consumer in this mode; keep the queue from overrunning
+      LoadCell_FlushSamples();
     }
 
     vTaskDelay(pdMS_TO_TICKS(10));
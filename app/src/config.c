@@ -1,20 +1,67 @@
 #include "config.h"
+#include "telemetry.h"
+#include "uart_tx_svc.h"
 #include "esp_log.h"
 #include <stdio.h>
 #include <stdarg.h>
 
+#define UART_PRINTF_MAX     512   // longest record: run cycle with quadrature and harmonics
+#define UART_PRINTF_PREFIX  32    // "I (<ms>) UART: "
+
 uint8_t mode = 0;
 uint32_t offTime = 60; // Default to 60 seconds
 uint8_t triggerFlg = 0;
 
+/* Private function prototypes */
+static void UART_VPrintf(uart_tx_lane_t lane, const char *format, va_list args);
+
+/* Formats in the caller and queues the line for the output task; never waits on the UART.
+   JSON lines keep the ESP_LOGI layout so host tools parse them unchanged.
+   UART_Printf is for events and one-off messages, UART_Reply for command
+   responses (sent ahead of everything else), UART_Stream for bulk telemetry. */
 void UART_Printf(const char *format, ...)
 {
-    char buffer[256];
     va_list args;
     va_start(args, format);
-    vsnprintf(buffer, sizeof(buffer), format, args);
+    UART_VPrintf(UART_TX_EVENT, format, args);
     va_end(args);
-    ESP_LOGI("UART", "%s", buffer);
 }
 
+void UART_Reply(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    UART_VPrintf(UART_TX_RESPONSE, format, args);
+    va_end(args);
+}
 
+void UART_Stream(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    UART_VPrintf(UART_TX_BULK, format, args);
+    va_end(args);
+}
+
+static void UART_VPrintf(uart_tx_lane_t lane, const char *format, va_list args)
+{
+    char buffer[UART_PRINTF_PREFIX + UART_PRINTF_MAX + 1];
+    int prefix = snprintf(buffer, UART_PRINTF_PREFIX, "I (%lu) UART: ", (unsigned long)esp_log_timestamp());
+    if (prefix < 0 || prefix >= UART_PRINTF_PREFIX) {
+        prefix = 0;
+    }
+    int len = vsnprintf(&buffer[prefix], UART_PRINTF_MAX, format, args);
+    if (len < 0) {
+        return;
+    }
+    if (len >= UART_PRINTF_MAX) {
+        len = UART_PRINTF_MAX - 1;
+    }
+    if (Telemetry_GetFormat() == TELEMETRY_BINARY) {
+        // Framed as a text record so it cannot be mistaken for binary data
+        Telemetry_SendText(lane, &buffer[prefix], (size_t)len);
+        return;
+    }
+    buffer[prefix + len] = '\n';
+    (void)UartTx_Write(lane, buffer, (size_t)(prefix + len + 1));
+}
@@ -0,0 +1,103 @@
+#include "cure_curve.h"
+#include <string.h>
+#include <math.h>
+
+/**
+  * @brief  Start a new cure curve
+  */
+void cure_curve_reset(cure_curve_t *cc)
+{
+    memset(cc, 0, sizeof(*cc));
+}
+
+/**
+  * @brief  Add one point of the cure curve (per-cycle torque)
+  * @param  cc: Curve
+  * @param  t_s: Time since the start of the run (s)
+  * @param  torque: Cycle torque (N·m)
+  * @note   Only the running maximum since ML is kept, as a monotone envelope,
+  *         and only when it rises by 1/512 of MH - ML; the times at which the
+  *         curve first reaches any level above ML come from that envelope.
+  *         When the envelope is full the point best predicted by its
+  *         neighbours is dropped. A new ML restarts the envelope.
+  */
+void cure_curve_add(cure_curve_t *cc, float t_s, double torque)
+{
+    cc->points++;
+    if (cc->n == 0 || torque < cc->ml) {
+        cc->ml = cc->mh = torque;
+        cc->t_ml = cc->t_mh = t_s;
+        cc->env[0].t_s = t_s;
+        cc->env[0].torque = (float)torque;
+        cc->n = 1;
+        return;
+    }
+    if (torque <= cc->mh) {
+        return;
+    }
+    cc->mh = torque;
+    cc->t_mh = t_s;
+    if (torque - (double)cc->env[cc->n - 1].torque < (cc->mh - cc->ml) / 512.0) {
+        return;
+    }
+    if (cc->n == CURE_ENVELOPE_POINTS) {
+        /* Drop the inner point that interpolation from its neighbours predicts best */
+        uint16_t drop = 1;
+        float best = -1.0f;
+        for (uint16_t i = 1; i + 1 < cc->n; i++) {
+            const cure_point_t *a = &cc->env[i - 1], *m = &cc->env[i], *b = &cc->env[i + 1];
+            float f = (m->torque - a->torque) / (b->torque - a->torque);
+            float err = fabsf(a->t_s + f * (b->t_s - a->t_s) - m->t_s);
+            if (best < 0.0f || err < best) {
+                best = err;
+                drop = i;
+            }
+        }
+        memmove(&cc->env[drop], &cc->env[drop + 1], (size_t)(cc->n - drop - 1) * sizeof(cure_point_t));
+        cc->n--;
+    }
+    cc->env[cc->n].t_s = t_s;
+    cc->env[cc->n].torque = (float)torque;
+    cc->n++;
+}
+
+/**
+  * @brief  First time the curve reached a torque level after ML
+  * @retval Seconds from the start of the run, -1 if not reached
+  */
+float cure_curve_time_at(const cure_curve_t *cc, double torque)
+{
+    if (cc->n == 0 || torque > cc->mh) {
+        return -1.0f;
+    }
+    if (torque <= (double)cc->env[0].torque) {
+        return cc->env[0].t_s;
+    }
+    for (uint16_t i = 1; i < cc->n; i++) {
+        const cure_point_t *a = &cc->env[i - 1];
+        const cure_point_t *b = &cc->env[i];
+        if ((double)b->torque >= torque) {
+            double f = (torque - (double)a->torque) / (double)(b->torque - a->torque);
+            return a->t_s + (float)f * (b->t_s - a->t_s);
+        }
+    }
+    /* Between the last envelope point and MH */
+    return cc->t_mh;
+}
+
+/**
+  * @brief  ML, MH, scorch times ts1/ts2 and cure times t10/t50/t90
+  */
+void cure_curve_result(const cure_curve_t *cc, cure_result_t *res)
+{
+    double span = cc->mh - cc->ml;
+    res->ml = cc->ml;
+    res->mh = cc->mh;
+    res->t_ml = cc->t_ml;
+    res->t_mh = cc->t_mh;
+    res->ts1 = cure_curve_time_at(cc, cc->ml + CURE_TS1_NM);
+    res->ts2 = cure_curve_time_at(cc, cc->ml + CURE_TS2_NM);
+    res->t10 = (span > 0.0) ? cure_curve_time_at(cc, cc->ml + 0.10 * span) : -1.0f;
+    res->t50 = (span > 0.0) ? cure_curve_time_at(cc, cc->ml + 0.50 * span) : -1.0f;
+    res->t90 = (span > 0.0) ? cure_curve_time_at(cc, cc->ml + 0.90 * span) : -1.0f;
+}
@@ -0,0 +1,196 @@
+#include "cure_fit.h"
+#include <math.h>
+#include <string.h>
+
+/*
+  First-order approach to MH:  dT/dt = k (MH - T)
+  Sampled L seconds apart this is exactly linear,
+      T(t) = a T(t - L) + c,   a = exp(-k L),   c = MH (1 - a),
+  so ordinary least squares on the pairs (T(t - L), T(t)) fits the model
+  from six running sums: O(1) per cycle and no stored curve beyond L.
+  T(t - L) is interpolated from the recent cycles. The MH/k/t90 bounds come
+  from the regression covariance, widened for autocorrelated residuals,
+  by first-order propagation (see cure_fit.h).
+*/
+
+/* Private function prototypes */
+static uint8_t cure_fit_lookback(const cure_fit_t *cf, float t_s, double *y);
+static float cure_fit_t90(float t_now, double y_now, double ml, double mh, double k);
+static double cure_fit_rho(const cure_fit_t *cf, double a, double c, double sse);
+
+void cure_fit_reset(cure_fit_t *cf)
+{
+    memset(cf, 0, sizeof(*cf));
+}
+
+/**
+  * @brief  Begin fitting (once curing has started, e.g. at ts2)
+  */
+void cure_fit_start(cure_fit_t *cf)
+{
+    cure_fit_reset(cf);
+    cf->started = 1;
+}
+
+/**
+  * @brief  Add one cycle of the cure curve (ignored before cure_fit_start)
+  */
+void cure_fit_add(cure_fit_t *cf, float t_s, double torque)
+{
+    if (!cf->started) {
+        return;
+    }
+    double x;
+    if (cure_fit_lookback(cf, t_s - CURE_FIT_LAG_S, &x)) {
+        if (cf->n == 0) {
+            cf->ref = x;
+        }
+        double xr = x - cf->ref, yr = torque - cf->ref;
+        if (cf->n == 0) {
+            cf->x1 = xr;
+            cf->y1 = yr;
+        } else {
+            cf->sxx1 += xr * cf->xp;
+            cf->sxy1 += xr * cf->yp;
+            cf->syx1 += yr * cf->xp;
+            cf->syy1 += yr * cf->yp;
+        }
+        cf->xp = xr;
+        cf->yp = yr;
+        cf->n++;
+        cf->sx += xr;
+        cf->sy += yr;
+        cf->sxx += xr * xr;
+        cf->sxy += xr * yr;
+        cf->syy += yr * yr;
+    }
+    cf->hist_t[cf->head] = t_s;
+    cf->hist_y[cf->head] = (float)torque;
+    cf->head = (uint16_t)((cf->head + 1) % CURE_FIT_HISTORY);
+    if (cf->count < CURE_FIT_HISTORY) {
+        cf->count++;
+    }
+    cf->last_t = t_s;
+    cf->last_y = torque;
+}
+
+/**
+  * @brief  Current model and its predictions
+  * @param  cf: Fit
+  * @param  ml: Minimum torque of the run (t90 level is ML + 0.9 (MH - ML))
+  * @param  res: Result
+  * @retval 1 if the fit is determined and describes an approach to a plateau
+  */
+uint8_t cure_fit_solve(const cure_fit_t *cf, double ml, cure_fit_result_t *res)
+{
+    if (cf->n < CURE_FIT_MIN_POINTS) {
+        return 0;
+    }
+    const double n = (double)cf->n;
+    const double d = n * cf->sxx - cf->sx * cf->sx;
+    if (d <= 0.0) {
+        return 0;
+    }
+    double a = (n * cf->sxy - cf->sx * cf->sy) / d;
+    double cr = (cf->sy - a * cf->sx) / n;
+    if (!(a > 0.0 && a < 1.0)) {
+        return 0;
+    }
+    double sse = cf->syy - a * cf->sxy - cr * cf->sy;
+    double rho = cure_fit_rho(cf, a, cr, sse);
+    double s2 = (sse > 0.0) ? sse / (n - 2.0) * (1.0 + rho) / (1.0 - rho) : 0.0;
+    double var_a = n * s2 / d;
+    double var_c = s2 * cf->sxx / d;
+    double cov_ac = -s2 * cf->sx / d;
+
+    /* MH = ref + c' / (1 - a), k = -ln(a) / L */
+    double om = 1.0 - a;
+    double mh = cf->ref + cr / om;
+    double g_a = cr / (om * om), g_c = 1.0 / om;
+    double sd_mh = sqrt(fmax(0.0, g_a * g_a * var_a + 2.0 * g_a * g_c * cov_ac + g_c * g_c * var_c));
+    double k = -log(a) / (double)CURE_FIT_LAG_S;
+    double sd_k = sqrt(var_a) / (a * (double)CURE_FIT_LAG_S);
+
+    res->mh = mh;
+    res->mh_ci_lo = mh - 2.0 * sd_mh;
+    res->mh_ci_hi = mh + 2.0 * sd_mh;
+    res->k = k;
+    res->k_ci_lo = fmax(0.0, k - 2.0 * sd_k);
+    res->k_ci_hi = k + 2.0 * sd_k;
+    res->rho = rho;
+    res->rms = sqrt(fmax(0.0, sse) / n);
+    res->points = cf->n;
+
+    /* t90 solved on the fitted exponential through the latest point (backwards
+       once that point is past the level); spread from the MH and k bounds */
+    res->t90 = cure_fit_t90(cf->last_t, cf->last_y, ml, mh, k);
+    if (res->t90 < 0.0f) {
+        res->t90_ci_lo = res->t90_ci_hi = res->t90;
+        return 1;
+    }
+    float a1 = cure_fit_t90(cf->last_t, cf->last_y, ml, res->mh_ci_hi, k) - res->t90;
+    float a2 = (res->k_ci_lo > 0.0) ? cure_fit_t90(cf->last_t, cf->last_y, ml, mh, res->k_ci_lo) - res->t90 : 0.0f;
+    float spread = sqrtf(a1 * a1 + a2 * a2);
+    res->t90_ci_lo = res->t90 - spread;
+    res->t90_ci_hi = res->t90 + spread;
+    return 1;
+}
+
+/* Value of the curve at t_s, interpolated between kept cycles */
+static uint8_t cure_fit_lookback(const cure_fit_t *cf, float t_s, double *y)
+{
+    if (cf->count < 2) {
+        return 0;
+    }
+    const uint16_t oldest = (uint16_t)((cf->head + CURE_FIT_HISTORY - cf->count) % CURE_FIT_HISTORY);
+    const float t_first = cf->hist_t[oldest];
+    const float t_last = cf->last_t;
+    if (!(t_s >= t_first && t_s <= t_last && t_last > t_first)) {
+        return 0;
+    }
+
+    /* Cycles are nearly evenly spaced: start at the index the mean period gives
+       and step to the bracketing pair (rarely more than one step) */
+    const uint16_t last = (uint16_t)(cf->count - 2);
+    float period = (t_last - t_first) / (float)(cf->count - 1);
+    uint16_t j = (uint16_t)fminf((t_s - t_first) / period, (float)last);
+    while (j > 0 && cf->hist_t[(oldest + j) % CURE_FIT_HISTORY] > t_s) {
+        j--;
+    }
+    while (j < last && cf->hist_t[(oldest + j + 1) % CURE_FIT_HISTORY] < t_s) {
+        j++;
+    }
+    uint16_t i0 = (uint16_t)((oldest + j) % CURE_FIT_HISTORY);
+    uint16_t i1 = (uint16_t)((oldest + j + 1) % CURE_FIT_HISTORY);
+    float span = cf->hist_t[i1] - cf->hist_t[i0];
+    float f = (span > 0.0f) ? (t_s - cf->hist_t[i0]) / span : 0.0f;
+    *y = (double)cf->hist_y[i0] + (double)f * (double)(cf->hist_y[i1] - cf->hist_y[i0]);
+    return 1;
+}
+
+/* Lag-1 autocorrelation of the residuals e_i = y_i - a x_i - c, expanded into
+   the running sums, clamped to 0 .. CURE_FIT_RHO_MAX */
+static double cure_fit_rho(const cure_fit_t *cf, double a, double c, double sse)
+{
+    if (!(sse > 0.0) || cf->n < 3) {
+        return 0.0;
+    }
+    const double m = (double)(cf->n - 1);
+    double sy2 = 2.0 * cf->sy - cf->y1 - cf->yp;    // sum of y_i + y_(i-1) over the lagged pairs
+    double sx2 = 2.0 * cf->sx - cf->x1 - cf->xp;
+    double lag = cf->syy1 - a * (cf->sxy1 + cf->syx1) + a * a * cf->sxx1
+               - c * sy2 + a * c * sx2 + c * c * m;
+    double rho = (lag / m) / (sse / (double)cf->n);
+    return fmin(fmax(rho, 0.0), CURE_FIT_RHO_MAX);
+}
+
+/* Time at which the curve through (t_now, y_now) reaches ML + 0.9 (MH - ML),
+   earlier than t_now if y_now is past it; -1 if the model has no such time */
+static float cure_fit_t90(float t_now, double y_now, double ml, double mh, double k)
+{
+    double level = ml + 0.9 * (mh - ml);
+    if (mh <= ml || k <= 0.0 || y_now >= mh) {
+        return -1.0f;
+    }
+    return t_now + (float)(log((mh - y_now) / (mh - level)) / k);
+}
@@ -0,0 +1,80 @@
+#include "cure_run.h"
+#include <math.h>
+
+/* Private function prototypes */
+static void cure_run_observed_t90(const cure_run_t *run, float t_s, cure_fit_result_t *fit);
+
+/**
+  * @brief  Start the analytics of a new run
+  * @param  run: Run
+  * @param  slope_per_min: Plateau criterion (N·m/min), 0 = run for the set time
+  * @param  window_s: How long the slope must stay below it
+  * @retval None
+  */
+void cure_run_start(cure_run_t *run, float slope_per_min, float window_s)
+{
+    cure_curve_reset(&run->curve);
+    cure_fit_reset(&run->fit);
+    plateau_config(&run->plateau, slope_per_min, window_s);
+    run->end_s = -1.0f;
+}
+
+/**
+  * @brief  Add one cycle of the run
+  * @param  run: Run
+  * @param  t_s: Time of the cycle since the start of the run (s)
+  * @param  torque: Filtered cycle amplitude (N·m)
+  * @param  fit: Out, the cure model after this cycle
+  * @note   The plateau detector is only fed once curing has started (past
+  *         ts2): the flat induction period, or a dip before ML, in its window
+  *         would pass for a plateau. A plateau therefore needs a full window_s
+  *         of cycles after scorch; run->end_s is set when it is detected.
+  *         Once the curve has passed the fitted t90 level, fit->t90 is the
+  *         observed crossing rather than a prediction.
+  * @retval 1 if fit holds a determined model
+  */
+uint8_t cure_run_add(cure_run_t *run, float t_s, double torque, cure_fit_result_t *fit)
+{
+    cure_curve_add(&run->curve, t_s, torque);
+    uint8_t past_ts2 = cure_run_past_ts2(run);
+
+    if (past_ts2 && plateau_add(&run->plateau, t_s, torque) && run->end_s < 0.0f) {
+        run->end_s = t_s;
+    }
+
+    if (past_ts2 && !run->fit.started) {
+        cure_fit_start(&run->fit);
+    }
+    cure_fit_add(&run->fit, t_s, torque);
+    if (!cure_fit_solve(&run->fit, run->curve.ml, fit)) {
+        return 0;
+    }
+    cure_run_observed_t90(run, t_s, fit);
+    return 1;
+}
+
+/**
+  * @brief  Curing has started: the curve has risen ML + CURE_TS2_NM
+  */
+uint8_t cure_run_past_ts2(const cure_run_t *run)
+{
+    return cure_curve_time_at(&run->curve, run->curve.ml + CURE_TS2_NM) >= 0.0f;
+}
+
+/* Replace the predicted t90 by the crossing of the curve so far, if it has
+   reached the level; the bounds are the crossings of the MH bound levels */
+static void cure_run_observed_t90(const cure_run_t *run, float t_s, cure_fit_result_t *fit)
+{
+    const double ml = run->curve.ml;
+    if (fit->mh <= ml) {
+        return;
+    }
+    float seen = cure_curve_time_at(&run->curve, ml + 0.9 * (fit->mh - ml));
+    if (seen < 0.0f) {
+        return;
+    }
+    fit->t90 = seen;
+    fit->t90_ci_lo = cure_curve_time_at(&run->curve, ml + 0.9 * (fmax(fit->mh_ci_lo, ml) - ml));
+    float hi = cure_curve_time_at(&run->curve, ml + 0.9 * (fit->mh_ci_hi - ml));
+    fit->t90_ci_hi = (hi >= 0.0f) ? hi : fmaxf(fit->t90_ci_hi, t_s);
+}
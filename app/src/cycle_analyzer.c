@@ -0,0 +1,273 @@
+#include "cycle_analyzer.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define CYCLE_ANALYZER_INTERVAL_ALPHA   (1.0 / 64.0)    // smoothing of the sample interval
+#define CYCLE_ANALYZER_RETUNE_SAMPLES   2               // SDFT window change that triggers a retune
+
+/* Private function prototypes */
+static void cycle_analyzer_begin(cycle_analyzer_t *ca);
+static void cycle_analyzer_tune(cycle_analyzer_t *ca, double freq_hz, uint8_t force);
+static void cycle_analyzer_cycle(cycle_analyzer_t *ca, const cycle_result_t *cycle);
+static void cycle_analyzer_emit(cycle_analyzer_t *ca, const cycle_result_t *last, cycle_window_t *out);
+
+/**
+  * @brief  Initialize a cycle analyzer
+  * @param  ca: Analyzer
+  * @param  cfg: Configuration (copied)
+  * @note   An analyzer turns the torque sample stream into per-window cycle
+  *         results: tracker, amplitude smoothing, live sliding-DFT amplitude
+  *         and, optionally, the per-cycle quadrature fit and harmonics.
+  *         Several analyzers can be fed the same samples.
+  * @retval None
+  */
+void cycle_analyzer_init(cycle_analyzer_t *ca, const cycle_analyzer_config_t *cfg)
+{
+    memset(ca, 0, sizeof(*ca));
+    ca->cfg = *cfg;
+    if (ca->cfg.window_cycles == 0) {
+        ca->cfg.window_cycles = 1;
+    }
+    cycle_tracker_init(&ca->tracker, cfg->nominal_hz);
+    cycle_tracker_set_peak_mode(&ca->tracker, cfg->peak_mode);
+    filter_chain_init(&ca->amp_filter, &cfg->smoothing, (cfg->smoothing.type == FILTER_NONE) ? 0 : 1);
+    ca->interval_us = 1e6 / (double)CYCLE_ANALYZER_SAMPLE_HZ;
+    cycle_analyzer_reset(ca);
+}
+
+/**
+  * @brief  Forget the signal history (keeps configuration and phase offset)
+  */
+void cycle_analyzer_reset(cycle_analyzer_t *ca)
+{
+    cycle_tracker_reset(&ca->tracker);
+    filter_chain_reset(&ca->amp_filter);
+    lockin_reset(&ca->lockin);
+    cycle_analyzer_tune(ca, ca->cfg.nominal_hz, 1);
+    ca->prev_us = 0;
+    cycle_analyzer_begin(ca);
+}
+
+/**
+  * @brief  Change the number of cycles per result
+  * @note   May be called from another task; takes effect at the end of the
+  *         window in progress
+  */
+void cycle_analyzer_set_window(cycle_analyzer_t *ca, uint8_t window_cycles)
+{
+    if (window_cycles < 1) window_cycles = 1;
+    if (window_cycles > CYCLE_ANALYZER_MAX_WINDOW) window_cycles = CYCLE_ANALYZER_MAX_WINDOW;
+    ca->cfg.window_cycles = window_cycles;
+}
+
+/**
+  * @brief  Retune to a new expected frequency (owner task only); restarts the analysis
+  */
+void cycle_analyzer_set_nominal(cycle_analyzer_t *ca, float nominal_hz)
+{
+    ca->cfg.nominal_hz = nominal_hz;
+    cycle_tracker_init(&ca->tracker, nominal_hz);
+    cycle_tracker_set_peak_mode(&ca->tracker, ca->cfg.peak_mode);
+    cycle_analyzer_reset(ca);
+}
+
+/**
+  * @brief  Change the cycle min/max estimate, see cycle_tracker_set_peak_mode()
+  * @note   May be called from another task; takes effect from the next cycle
+  */
+void cycle_analyzer_set_peak_mode(cycle_analyzer_t *ca, cycle_peak_mode_t mode)
+{
+    ca->cfg.peak_mode = mode;
+    cycle_tracker_set_peak_mode(&ca->tracker, mode);
+}
+
+/**
+  * @brief  Smoothed amplitude of the last window (0 before the first)
+  */
+double cycle_analyzer_amp(const cycle_analyzer_t *ca)
+{
+    return filter_chain_output(&ca->amp_filter);
+}
+
+/**
+  * @brief  Amplitude over the last period, updated every sample
+  */
+double cycle_analyzer_live(const cycle_analyzer_t *ca)
+{
+    return sdft_amplitude(&ca->sdft);
+}
+
+/**
+  * @brief  Amplitude smoothing chain, for filter_chain_request() from another task
+  */
+filter_chain_t *cycle_analyzer_filter(cycle_analyzer_t *ca)
+{
+    return &ca->amp_filter;
+}
+
+/**
+  * @brief  Feed one sample
+  * @param  ca: Analyzer
+  * @param  t_us: Sample timestamp (us)
+  * @param  x: Torque
+  * @param  out: Filled when a window completes
+  * @retval 1 if out holds a completed window
+  */
+uint8_t cycle_analyzer_feed(cycle_analyzer_t *ca, int64_t t_us, double x, cycle_window_t *out)
+{
+    cycle_result_t cycle;
+    uint8_t done = 0;
+
+    if (ca->prev_us != 0 && t_us > ca->prev_us) {
+        ca->interval_us += CYCLE_ANALYZER_INTERVAL_ALPHA * ((double)(t_us - ca->prev_us) - ca->interval_us);
+    }
+    ca->prev_us = t_us;
+
+    if (cycle_tracker_feed(&ca->tracker, t_us, x, &cycle)) {
+        // The lock-in buffer holds exactly the cycle just closed
+        cycle_analyzer_cycle(ca, &cycle);
+        lockin_reset(&ca->lockin);
+        if (cycle.locked) {
+            cycle_analyzer_tune(ca, cycle.freq_hz, 0);
+        }
+        if (ca->cycles >= ca->cfg.window_cycles) {
+            cycle_analyzer_emit(ca, &cycle, out);
+            cycle_analyzer_begin(ca);
+            done = 1;
+        }
+    }
+    if (ca->cfg.quadrature) {
+        lockin_add(&ca->lockin, t_us, x);
+    }
+    (void)sdft_update(&ca->sdft, x);
+    return done;
+}
+
+static void cycle_analyzer_begin(cycle_analyzer_t *ca)
+{
+    ca->cycles = 0;
+    ca->all_locked = 1;
+    ca->amp_sum = 0.0;
+    ca->min = 1e300;
+    ca->max = -1e300;
+    ca->quad_n = 0;
+    ca->sp_sum = ca->sdp_sum = ca->mean_sum = 0.0;
+    ca->harm_n = 0;
+    ca->rms2_sum = 0.0;
+    memset(ca->mag_sum, 0, sizeof(ca->mag_sum));
+}
+
+/* Size the sliding DFT to one period at freq_hz. force (reset, new nominal)
+   starts it empty; a measured period retunes it, keeping the signal, only
+   once it is CYCLE_ANALYZER_RETUNE_SAMPLES off, so jitter across a rounding
+   boundary costs nothing */
+static void cycle_analyzer_tune(cycle_analyzer_t *ca, double freq_hz, uint8_t force)
+{
+    uint16_t n = (uint16_t)(1e6 / (freq_hz * ca->interval_us) + 0.5);
+    if (force) {
+        if (!sdft_init(&ca->sdft, n)) {
+            sdft_reset(&ca->sdft);
+        }
+    } else if (abs((int)n - (int)ca->sdft.n) >= CYCLE_ANALYZER_RETUNE_SAMPLES) {
+        (void)sdft_retune(&ca->sdft, n);
+    }
+}
+
+/* Accumulate one tracked cycle into the window */
+static void cycle_analyzer_cycle(cycle_analyzer_t *ca, const cycle_result_t *cycle)
+{
+    if (ca->cycles == 0) {
+        ca->start_us = cycle->start_us;
+    }
+    ca->cycles++;
+    ca->all_locked &= cycle->locked;
+    ca->amp_sum += cycle->amp;
+    if (cycle->min < ca->min) {
+        ca->min = cycle->min;
+        ca->t_min_us = cycle->t_min_us;
+    }
+    if (cycle->max > ca->max) {
+        ca->max = cycle->max;
+        ca->t_max_us = cycle->t_max_us;
+    }
+
+    if (!ca->cfg.quadrature) {
+        return;
+    }
+
+    /* Quadrature fit against the strain reference, else the cycle itself;
+       the latter gives exact amplitude but phase only relative to set_phase_ref */
+    lockin_result_t q;
+    int64_t ref_us, period_us;
+    uint8_t ext = (ca->cfg.ref != NULL) && ca->cfg.ref(&ref_us, &period_us);
+    if (!ext) {
+        ref_us = cycle->start_us;
+        period_us = cycle->period_us;
+    }
+    if (lockin_solve(&ca->lockin, ref_us, (double)period_us, 0.0, &q)) {
+        ca->last_phase_deg = q.phase_deg;
+        double d = (q.phase_deg - (double)ca->phase_offset_deg) * (M_PI / 180.0);
+        ca->sp_sum += q.amp * cos(d);
+        ca->sdp_sum += q.amp * sin(d);
+        ca->mean_sum += q.mean;
+        ca->quad_ref = ext;
+        ca->quad_n++;
+    }
+
+    // Harmonics only over a whole (locked) cycle
+    lockin_harmonics_t h;
+    if (cycle->locked && lockin_harmonics(&ca->lockin, (double)cycle->period_us, &h)) {
+        ca->rms2_sum += h.rms * h.rms;
+        for (uint8_t k = 0; k < LOCKIN_HARMONICS; k++) {
+            ca->mag_sum[k] += h.mag[k];
+        }
+        ca->harm_n++;
+    }
+}
+
+static void cycle_analyzer_emit(cycle_analyzer_t *ca, const cycle_result_t *last, cycle_window_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->start_us = ca->start_us;
+    out->period_us = (last->start_us + last->period_us) - ca->start_us;
+    out->freq_hz = last->freq_hz;
+    out->locked = ca->all_locked;
+    out->cycles = ca->cycles;
+    out->amp = ca->amp_sum / (double)ca->cycles;
+    out->amp_filtered = filter_chain_apply(&ca->amp_filter, out->amp);
+    out->min = ca->min;
+    out->max = ca->max;
+    out->t_min_us = ca->t_min_us;
+    out->t_max_us = ca->t_max_us;
+
+    if (ca->quad_n > 0) {
+        lockin_result_t *q = &out->quad;
+        q->s_prime = ca->sp_sum / (double)ca->quad_n;
+        q->s_dprime = ca->sdp_sum / (double)ca->quad_n;
+        q->mean = ca->mean_sum / (double)ca->quad_n;
+        q->amp = hypot(q->s_prime, q->s_dprime);
+        q->phase_deg = atan2(q->s_dprime, q->s_prime) * (180.0 / M_PI);
+        q->tan_delta = (q->s_prime != 0.0) ? q->s_dprime / q->s_prime : 0.0;
+        q->samples = ca->quad_n;
+        out->quad_ref = ca->quad_ref;
+        out->has_quad = 1;
+    }
+    if (ca->harm_n > 0) {
+        double harm2 = 0.0;
+        for (uint8_t k = 0; k < LOCKIN_HARMONICS; k++) {
+            out->harm.mag[k] = ca->mag_sum[k] / (double)ca->harm_n;
+            if (k > 0) {
+                harm2 += out->harm.mag[k] * out->harm.mag[k];
+            }
+        }
+        out->harm.rms = sqrt(ca->rms2_sum / (double)ca->harm_n);
+        out->harm.thd = (out->harm.mag[0] > 0.0) ? sqrt(harm2) / out->harm.mag[0] : 0.0;
+        out->harm.samples = ca->harm_n;
+        out->has_harm = 1;
+    }
+}
@@ -0,0 +1,258 @@
+#include "cycle_tracker.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Private function prototypes */
+static void cycle_tracker_begin(cycle_tracker_t *ct, int64_t t_us);
+static void cycle_tracker_emit(cycle_tracker_t *ct, int64_t end_us, uint8_t locked, cycle_result_t *out);
+static void cycle_peak_note(cycle_peak_t *pk, const cycle_tracker_t *ct, int64_t t_us, double x);
+static void cycle_peak_refine(const cycle_tracker_t *ct, const cycle_peak_t *pk, int sign, double *x, int64_t *t_us);
+
+/**
+  * @brief  Initialize a cycle tracker
+  * @param  ct: Tracker
+  * @param  nominal_hz: Expected oscillation frequency; bounds the accepted
+  *         period and paces the fallback windows while not locked
+  * @retval None
+  */
+void cycle_tracker_init(cycle_tracker_t *ct, float nominal_hz)
+{
+    memset(ct, 0, sizeof(*ct));
+    ct->nominal_hz = nominal_hz;
+    cycle_tracker_reset(ct);
+}
+
+/**
+  * @brief  Forget the signal history (keeps the nominal frequency)
+  */
+void cycle_tracker_reset(cycle_tracker_t *ct)
+{
+    float nominal_hz = ct->nominal_hz;
+    cycle_peak_mode_t peak_mode = ct->peak_mode;
+    memset(ct, 0, sizeof(*ct));
+    ct->nominal_hz = nominal_hz;
+    ct->peak_mode = peak_mode;
+    ct->cur_min = 1e300;
+    ct->cur_max = -1e300;
+}
+
+/**
+  * @brief  Measured oscillation frequency (Hz), 0 until the first locked cycle
+  */
+double cycle_tracker_freq(const cycle_tracker_t *ct)
+{
+    return (ct->period_us > 0.0) ? 1e6 / ct->period_us : 0.0;
+}
+
+/**
+  * @brief  Select how cycle extremes are estimated (takes effect from the next cycle)
+  * @note   With few samples per cycle the largest sample falls short of the
+  *         true crest by up to 1 - cos(pi / samples_per_cycle) of the amplitude
+  *         (13 % at 6 samples). The interpolating modes fit the extreme
+  *         sample and its two neighbours: a parabola, or a sinusoid at the
+  *         tracked frequency, which is exact for a sinusoidal torque.
+  */
+void cycle_tracker_set_peak_mode(cycle_tracker_t *ct, cycle_peak_mode_t mode)
+{
+    ct->peak_mode = mode;
+}
+
+/**
+  * @brief  Feed one sample
+  * @param  ct: Tracker
+  * @param  t_us: Sample timestamp (us)
+  * @param  x: Offset-corrected torque
+  * @param  out: Filled when a cycle completes
+  * @note   A cycle runs from one upward crossing of the signal centre (the
+  *         previous cycle's mid-range) to the next, timed by linear
+  *         interpolation between the samples around the crossing. The
+  *         crossing only re-arms after the signal drops CYCLE_HYSTERESIS
+  *         amplitudes below the centre, so noise cannot split a cycle. With no
+  *         usable crossing (die stopped, uncalibrated torque) cycles fall back
+  *         to nominal-length windows reported as unlocked.
+  * @retval 1 if out holds a completed cycle
+  */
+uint8_t cycle_tracker_feed(cycle_tracker_t *ct, int64_t t_us, double x, cycle_result_t *out)
+{
+    const double nominal_us = 1e6 / (double)ct->nominal_hz;
+    uint8_t done = 0;
+
+    if (!ct->started) {
+        cycle_tracker_begin(ct, t_us);
+        ct->started = 1;
+    }
+
+    /* This sample is the right-hand neighbour of an extreme set by the previous one */
+    if (ct->cur_n > 0 && ct->pk_max.t_us[1] == ct->prev_us && !ct->pk_max.have_after) {
+        ct->pk_max.t_us[2] = t_us;
+        ct->pk_max.x[2] = x;
+        ct->pk_max.have_after = 1;
+    }
+    if (ct->cur_n > 0 && ct->pk_min.t_us[1] == ct->prev_us && !ct->pk_min.have_after) {
+        ct->pk_min.t_us[2] = t_us;
+        ct->pk_min.x[2] = x;
+        ct->pk_min.have_after = 1;
+    }
+
+    /* Timeout: no crossing for too long, close the window as it is
+       (one nominal period while searching for a crossing) */
+    if ((double)(t_us - ct->start_us) >= (ct->synced ? CYCLE_TIMEOUT : 1.0) * nominal_us) {
+        if (ct->cur_n > 0) {
+            cycle_tracker_emit(ct, t_us, 0, out);
+            done = 1;
+        }
+        ct->synced = 0;
+        cycle_tracker_begin(ct, t_us);
+    }
+
+    double centre, amp;
+    if (ct->has_prev) {
+        centre = ct->centre;
+        amp = ct->amp;
+    } else {
+        centre = (ct->cur_n > 0) ? 0.5 * (ct->cur_min + ct->cur_max) : x;
+        amp = (ct->cur_n > 0) ? 0.5 * (ct->cur_max - ct->cur_min) : 0.0;
+    }
+    double d = x - centre;
+
+    if (ct->state != -1 && d < -CYCLE_HYSTERESIS * amp) {
+        ct->state = -1;
+    } else if (ct->state == -1 && d >= 0.0 && ct->cur_n > 0) {
+        ct->state = 1;
+        int64_t t_cross = t_us;
+        if (d > ct->prev_d) {
+            t_cross = ct->prev_us + (int64_t)((double)(t_us - ct->prev_us) * (-ct->prev_d) / (d - ct->prev_d));
+        }
+        double period = (double)(t_cross - ct->start_us);
+        if (!ct->synced) {
+            /* First crossing (or first after a timeout): start counting from here */
+            if (!ct->has_prev) {
+                ct->centre = centre;
+                ct->amp = amp;
+                ct->has_prev = 1;
+            }
+            ct->synced = 1;
+            cycle_tracker_begin(ct, t_cross);
+        } else if (period >= CYCLE_MIN_PERIOD * nominal_us) {
+            ct->period_us = (ct->period_us > 0.0) ? ct->period_us + CYCLE_FREQ_ALPHA * (period - ct->period_us) : period;
+            cycle_tracker_emit(ct, t_cross, 1, out);
+            done = 1;
+            cycle_tracker_begin(ct, t_cross);
+        }
+        /* else: too short to be a cycle, keep accumulating */
+    }
+
+    if (x < ct->cur_min) {
+        ct->cur_min = x;
+        cycle_peak_note(&ct->pk_min, ct, t_us, x);
+    }
+    if (x > ct->cur_max) {
+        ct->cur_max = x;
+        cycle_peak_note(&ct->pk_max, ct, t_us, x);
+    }
+    ct->cur_n++;
+    ct->prev_us = t_us;
+    ct->prev_d = d;
+    ct->prev_x = x;
+    ct->has_prev_x = 1;
+    return done;
+}
+
+static void cycle_tracker_begin(cycle_tracker_t *ct, int64_t t_us)
+{
+    ct->start_us = t_us;
+    ct->cur_min = 1e300;
+    ct->cur_max = -1e300;
+    ct->cur_n = 0;
+    memset(&ct->pk_min, 0, sizeof(ct->pk_min));
+    memset(&ct->pk_max, 0, sizeof(ct->pk_max));
+}
+
+static void cycle_tracker_emit(cycle_tracker_t *ct, int64_t end_us, uint8_t locked, cycle_result_t *out)
+{
+    out->start_us = ct->start_us;
+    out->period_us = end_us - ct->start_us;
+    out->freq_hz = (ct->period_us > 0.0) ? 1e6 / ct->period_us : (double)ct->nominal_hz;
+    cycle_peak_refine(ct, &ct->pk_min, -1, &out->min, &out->t_min_us);
+    cycle_peak_refine(ct, &ct->pk_max, 1, &out->max, &out->t_max_us);
+    out->amp = 0.5 * (out->max - out->min);
+    out->samples = ct->cur_n;
+    out->locked = locked;
+    /* An unlocked window may not span a whole cycle; re-derive the centre from scratch */
+    ct->centre = 0.5 * (out->min + out->max);
+    ct->amp = out->amp;
+    ct->has_prev = locked;
+}
+
+/* A new extreme: remember it with the sample before it */
+static void cycle_peak_note(cycle_peak_t *pk, const cycle_tracker_t *ct, int64_t t_us, double x)
+{
+    pk->have_before = ct->has_prev_x;
+    pk->t_us[0] = ct->prev_us;
+    pk->x[0] = ct->prev_x;
+    pk->t_us[1] = t_us;
+    pk->x[1] = x;
+    pk->have_after = 0;
+}
+
+/* Interpolated extreme (sign +1: maximum, -1: minimum); the sample itself when
+   a neighbour is missing or the fit puts the extreme outside them */
+static void cycle_peak_refine(const cycle_tracker_t *ct, const cycle_peak_t *pk, int sign, double *x, int64_t *t_us)
+{
+    *x = pk->x[1];
+    *t_us = pk->t_us[1];
+    if (ct->peak_mode == CYCLE_PEAK_SAMPLE || !pk->have_before || !pk->have_after) {
+        return;
+    }
+
+    /* Times relative to the extreme sample, in seconds */
+    const double u0 = (double)(pk->t_us[0] - pk->t_us[1]) * 1e-6;
+    const double u2 = (double)(pk->t_us[2] - pk->t_us[1]) * 1e-6;
+    const double y0 = pk->x[0], y1 = pk->x[1], y2 = pk->x[2];
+    if (!(u0 < 0.0 && u2 > 0.0)) {
+        return;
+    }
+    double u, v;
+
+    if (ct->peak_mode == CYCLE_PEAK_PARABOLA) {
+        /* y = a u^2 + b u + y1 */
+        double det = u0 * u2 * (u0 - u2);
+        double a = ((y0 - y1) * u2 - (y2 - y1) * u0) / det;
+        double b = (u0 * u0 * (y2 - y1) - u2 * u2 * (y0 - y1)) / det;
+        if (a * sign >= 0.0) {
+            return;
+        }
+        u = -b / (2.0 * a);
+        v = y1 - b * b / (4.0 * a);
+    } else {
+        /* y = c + p cos(w u) + q sin(w u), w from the tracked period */
+        double period_us = (ct->period_us > 0.0) ? ct->period_us : 1e6 / (double)ct->nominal_hz;
+        double w = 2.0 * M_PI / (period_us * 1e-6);
+        double c0 = cos(w * u0), s0 = sin(w * u0), c2 = cos(w * u2), s2 = sin(w * u2);
+        /* Rows [1 c0 s0; 1 1 0; 1 c2 s2] (u1 = 0), Cramer's rule */
+        double det = s2 - c0 * s2 + s0 * (c2 - 1.0);
+        if (fabs(det) < 1e-9) {
+            return;
+        }
+        double c = (y0 * s2 - c0 * y1 * s2 + s0 * (y1 * c2 - y2)) / det;
+        double p = (y1 * s2 - y0 * s2 + s0 * (y2 - y1)) / det;
+        double q = (y2 - c2 * y1 - c0 * (y2 - y1) + y0 * (c2 - 1.0)) / det;
+        double r = hypot(p, q);
+        double ph = atan2(q, p);                  // y = c + r cos(w u - ph)
+        if (sign < 0) {
+            ph = (ph > 0.0) ? ph - M_PI : ph + M_PI;
+        }
+        u = ph / w;
+        v = c + sign * r;
+    }
+
+    if (u < u0 || u > u2 || (v - y1) * sign < 0.0) {
+        return;
+    }
+    *x = v;
+    *t_us = pk->t_us[1] + (int64_t)(u * 1e6);
+}
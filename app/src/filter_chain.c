@@ -0,0 +1,402 @@
+#include "filter_chain.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+/* Private function prototypes */
+static void filter_stage_reset(filter_stage_t *st);
+static double filter_stage_apply(filter_chain_t *chain, filter_stage_t *st, double x, uint8_t integer);
+static void filter_sum_add(filter_stage_t *st, double v);
+static double filter_median(double *v, uint16_t n);
+static void filter_chain_layout(filter_chain_t *chain);
+static uint8_t filter_chain_take_pending(filter_chain_t *chain);
+static void filter_chain_clear(filter_chain_t *chain);
+
+/**
+  * @brief  Configure a chain and clear its state
+  * @param  chain: Chain to initialize
+  * @param  spec: Stages, applied in order (NULL/0 passes samples through)
+  * @param  stages: Number of entries in spec (at most FILTER_MAX_STAGES, and
+  *           stages beyond what fits FILTER_POOL_SAMPLES are dropped)
+  * @retval None
+  */
+void filter_chain_init(filter_chain_t *chain, const filter_spec_t *spec, uint8_t stages)
+{
+    memset(chain, 0, sizeof(*chain));
+    if (stages > FILTER_MAX_STAGES) {
+        stages = FILTER_MAX_STAGES;
+    }
+    while (stages > 0 && !filter_spec_fits(spec, stages)) {
+        stages--;
+    }
+    for (uint8_t i = 0; i < stages; i++) {
+        chain->stage[i].spec = spec[i];
+    }
+    chain->stages = stages;
+    filter_chain_layout(chain);
+}
+
+/**
+  * @brief  Declare the input whole numbers (raw conversions)
+  * @note   A moving average in the first stage then keeps an exact integer
+  *         running sum; later stages see fractional values and do not.
+  */
+void filter_chain_set_integer(filter_chain_t *chain)
+{
+    chain->integer_input = 1;
+}
+
+/**
+  * @brief  Clear the filter history, keeping the configuration
+  * @note   Owner task only; also takes a pending reconfiguration
+  */
+void filter_chain_reset(filter_chain_t *chain)
+{
+    (void)filter_chain_take_pending(chain);
+    filter_chain_clear(chain);
+}
+
+/**
+  * @brief  Run one sample through every stage
+  * @note   Owner task only. The history restarts once, when a pending
+  *         reconfiguration is taken; while the writer is still mid-update
+  *         the current stages keep filtering.
+  * @retval Filtered value
+  */
+double filter_chain_apply(filter_chain_t *chain, double x)
+{
+    if (chain->pending_seq != chain->applied_seq && filter_chain_take_pending(chain)) {
+        filter_chain_clear(chain);
+    }
+    for (uint8_t i = 0; i < chain->stages; i++) {
+        x = filter_stage_apply(chain, &chain->stage[i], x, chain->integer_input && i == 0);
+    }
+    chain->out = x;
+    chain->has_out = 1;
+    return x;
+}
+
+/**
+  * @brief  Last value returned by filter_chain_apply() (0 before the first sample)
+  */
+double filter_chain_output(const filter_chain_t *chain)
+{
+    return chain->has_out ? chain->out : 0.0;
+}
+
+/**
+  * @brief  Reconfigure a chain owned by another task
+  * @param  chain: Target chain
+  * @param  text: Stage list, see filter_spec_parse()
+  * @note   Single writer. The owner swaps the stages in and restarts the
+  *         history on its next apply/reset, so no sample sees a half-built chain.
+  * @retval Number of stages, -1 if text is invalid (chain unchanged)
+  */
+int filter_chain_request(filter_chain_t *chain, const char *text)
+{
+    filter_spec_t spec[FILTER_MAX_STAGES];
+    int n = filter_spec_parse(text, spec, FILTER_MAX_STAGES);
+    if (n < 0) {
+        return -1;
+    }
+    uint32_t seq = chain->pending_seq;
+    if (seq & 1) {
+        seq++;
+    }
+    chain->pending_seq = seq + 1;
+    __sync_synchronize();
+    memcpy(chain->pending, spec, sizeof(spec));
+    chain->pending_stages = (uint8_t)n;
+    __sync_synchronize();
+    chain->pending_seq = seq + 2;
+    return n;
+}
+
+/**
+  * @brief  Text form of the configuration, including a not yet applied request
+  * @retval Characters written (excluding the terminator)
+  */
+int filter_chain_describe(const filter_chain_t *chain, char *out, int out_sz)
+{
+    if (chain->pending_seq != chain->applied_seq) {
+        return filter_spec_format(chain->pending, chain->pending_stages, out, out_sz);
+    }
+    filter_spec_t spec[FILTER_MAX_STAGES];
+    for (uint8_t i = 0; i < chain->stages; i++) {
+        spec[i] = chain->stage[i].spec;
+    }
+    return filter_spec_format(spec, chain->stages, out, out_sz);
+}
+
+/**
+  * @brief  Parse a comma separated stage list
+  * @param  text: e.g. "hampel:7:3,ma:10,iir:0.2"; "none" for a pass-through chain
+  *           (at most FILTER_MAX_STAGES stages; the ma/median/hampel windows N
+  *           share FILTER_POOL_SAMPLES, and a median/hampel N is at most
+  *           FILTER_MAX_RANK)
+  *           ma:N          moving average over N samples
+  *           median:N      running median over N samples
+  *           hampel:N[:K]  replace samples more than K (default 3) sigmas from the
+  *                         N-sample median, sigma estimated as 1.4826 * MAD
+  *           iir:A         first order low-pass, 0 < A <= 1
+  * @param  spec: Out, parsed stages
+  * @param  max_stages: Capacity of spec
+  * @retval Number of stages, -1 on a syntax or range error
+  */
+int filter_spec_parse(const char *text, filter_spec_t *spec, uint8_t max_stages)
+{
+    if (text == NULL || *text == '\0') {
+        return -1;
+    }
+    if (strcmp(text, "none") == 0) {
+        return 0;
+    }
+
+    int n = 0;
+    const char *p = text;
+    for (;;) {
+        if (n >= max_stages) {
+            return -1;
+        }
+        filter_spec_t *s = &spec[n];
+        char *end;
+        if (strncmp(p, "ma:", 3) == 0) {
+            long w = strtol(p + 3, &end, 10);
+            if (end == p + 3 || w < 1 || w > FILTER_POOL_SAMPLES) return -1;
+            s->type = FILTER_MA; s->window = (uint16_t)w; s->param = 0.0f;
+        } else if (strncmp(p, "median:", 7) == 0 || strncmp(p, "hampel:", 7) == 0) {
+            long w = strtol(p + 7, &end, 10);
+            if (end == p + 7 || w < 3 || w > FILTER_MAX_RANK) return -1;
+            double k = (p[0] == 'h') ? 3.0 : 0.0;
+            if (p[0] == 'h' && *end == ':') {
+                const char *q = end + 1;
+                k = strtod(q, &end);
+                if (end == q || !(k > 0.0)) return -1;
+            }
+            s->type = FILTER_HAMPEL; s->window = (uint16_t)w; s->param = (float)k;
+        } else if (strncmp(p, "iir:", 4) == 0) {
+            double a = strtod(p + 4, &end);
+            if (end == p + 4 || !(a > 0.0 && a <= 1.0)) return -1;
+            s->type = FILTER_IIR; s->window = 0; s->param = (float)a;
+        } else {
+            return -1;
+        }
+        n++;
+        if (*end == '\0') {
+            return filter_spec_fits(spec, (uint8_t)n) ? n : -1;
+        }
+        if (*end != ',') {
+            return -1;
+        }
+        p = end + 1;
+    }
+}
+
+/**
+  * @brief  The windows of the stages fit the history of one chain
+  */
+uint8_t filter_spec_fits(const filter_spec_t *spec, uint8_t stages)
+{
+    uint32_t total = 0;
+    for (uint8_t i = 0; i < stages; i++) {
+        if (spec[i].type == FILTER_MA || spec[i].type == FILTER_HAMPEL) {
+            total += spec[i].window;
+        }
+    }
+    return total <= FILTER_POOL_SAMPLES;
+}
+
+/**
+  * @brief  Inverse of filter_spec_parse()
+  * @retval Characters written (excluding the terminator)
+  */
+int filter_spec_format(const filter_spec_t *spec, uint8_t stages, char *out, int out_sz)
+{
+    int n = 0;
+    if (out_sz <= 0) {
+        return 0;
+    }
+    out[0] = '\0';
+    if (stages == 0) {
+        return snprintf(out, (size_t)out_sz, "none");
+    }
+    for (uint8_t i = 0; i < stages && n < out_sz; i++) {
+        const filter_spec_t *s = &spec[i];
+        const char *sep = i ? "," : "";
+        switch (s->type) {
+        case FILTER_MA:
+            n += snprintf(out + n, (size_t)(out_sz - n), "%sma:%u", sep, (unsigned)s->window);
+            break;
+        case FILTER_HAMPEL:
+            if (s->param > 0.0f) {
+                n += snprintf(out + n, (size_t)(out_sz - n), "%shampel:%u:%g", sep, (unsigned)s->window, (double)s->param);
+            } else {
+                n += snprintf(out + n, (size_t)(out_sz - n), "%smedian:%u", sep, (unsigned)s->window);
+            }
+            break;
+        case FILTER_IIR:
+            n += snprintf(out + n, (size_t)(out_sz - n), "%siir:%g", sep, (double)s->param);
+            break;
+        default:
+            break;
+        }
+    }
+    return (n < out_sz) ? n : out_sz - 1;
+}
+
+/**
+  * @brief  Copy a complete pending configuration into the stages
+  * @note   Retried on the next call if the writer was mid-update
+  * @retval 1 if a new configuration was taken
+  */
+static uint8_t filter_chain_take_pending(filter_chain_t *chain)
+{
+    uint32_t seq = chain->pending_seq;
+    if (seq == chain->applied_seq || (seq & 1)) {
+        return 0;
+    }
+    __sync_synchronize();
+    filter_spec_t spec[FILTER_MAX_STAGES];
+    uint8_t stages = chain->pending_stages;
+    memcpy(spec, chain->pending, sizeof(spec));
+    __sync_synchronize();
+    if (chain->pending_seq != seq || stages > FILTER_MAX_STAGES || !filter_spec_fits(spec, stages)) {
+        return 0;
+    }
+    for (uint8_t i = 0; i < stages; i++) {
+        chain->stage[i].spec = spec[i];
+    }
+    chain->stages = stages;
+    filter_chain_layout(chain);
+    chain->applied_seq = seq;
+    return 1;
+}
+
+/* Give each windowed stage its slice of the pool */
+static void filter_chain_layout(filter_chain_t *chain)
+{
+    uint16_t offset = 0;
+    for (uint8_t i = 0; i < chain->stages; i++) {
+        filter_stage_t *st = &chain->stage[i];
+        st->offset = offset;
+        if (st->spec.type == FILTER_MA || st->spec.type == FILTER_HAMPEL) {
+            offset = (uint16_t)(offset + st->spec.window);
+        }
+    }
+}
+
+static void filter_chain_clear(filter_chain_t *chain)
+{
+    for (uint8_t i = 0; i < chain->stages; i++) {
+        filter_stage_reset(&chain->stage[i]);
+    }
+    chain->out = 0.0;
+    chain->has_out = 0;
+}
+
+static void filter_stage_reset(filter_stage_t *st)
+{
+    st->index = 0;
+    st->count = 0;
+    st->isum = 0;
+    st->sum = st->comp = 0.0;
+    st->y = 0.0;
+}
+
+static double filter_stage_apply(filter_chain_t *chain, filter_stage_t *st, double x, uint8_t integer)
+{
+    const uint16_t w = st->spec.window;
+    double *buf = &chain->pool[st->offset];
+
+    switch (st->spec.type) {
+    case FILTER_MA:
+        /* Every sample costs the same: whole numbers sum exactly in 64 bits,
+           other values in a compensated sum, so nothing needs re-summing */
+        if (integer) {
+            int64_t xi = (int64_t)x;
+            if (st->count == w) {
+                st->isum -= (int64_t)buf[st->index];
+            } else {
+                st->count++;
+            }
+            buf[st->index] = (double)xi;
+            st->isum += xi;
+        } else {
+            if (st->count == w) {
+                filter_sum_add(st, -buf[st->index]);
+            } else {
+                st->count++;
+            }
+            buf[st->index] = x;
+            filter_sum_add(st, x);
+        }
+        if (++st->index >= w) {
+            st->index = 0;
+        }
+        return (integer ? (double)st->isum : st->sum + st->comp) / (double)st->count;
+
+    case FILTER_HAMPEL: {
+        buf[st->index] = x;
+        st->index = (uint16_t)((st->index + 1) % w);
+        if (st->count < w) {
+            st->count++;
+        }
+        if (st->count < 3) {
+            return x;
+        }
+        double *v = chain->scratch;
+        memcpy(v, buf, st->count * sizeof(double));
+        double med = filter_median(v, st->count);
+        if (st->spec.param <= 0.0f) {
+            return med;
+        }
+        for (uint16_t i = 0; i < st->count; i++) {
+            v[i] = fabs(buf[i] - med);
+        }
+        double sigma = 1.4826 * filter_median(v, st->count);
+        return (fabs(x - med) > (double)st->spec.param * sigma) ? med : x;
+    }
+
+    case FILTER_IIR:
+        if (st->count == 0) {
+            st->y = x;
+            st->count = 1;
+        } else {
+            st->y += (double)st->spec.param * (x - st->y);
+        }
+        return st->y;
+
+    default:
+        return x;
+    }
+}
+
+/* Kahan-Babuska (Neumaier) compensated add to the MA running sum */
+static void filter_sum_add(filter_stage_t *st, double v)
+{
+    double t = st->sum + v;
+    if (fabs(st->sum) >= fabs(v)) {
+        st->comp += (st->sum - t) + v;
+    } else {
+        st->comp += (v - t) + st->sum;
+    }
+    st->sum = t;
+}
+
+/**
+  * @brief  Median of a short array (sorted in place)
+  */
+static double filter_median(double *v, uint16_t n)
+{
+    for (uint16_t i = 1; i < n; i++) {
+        double t = v[i];
+        uint16_t j = i;
+        while (j > 0 && v[j - 1] > t) {
+            v[j] = v[j - 1];
+            j--;
+        }
+        v[j] = t;
+    }
+    return (n & 1) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+}
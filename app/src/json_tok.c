@@ -0,0 +1,300 @@
+#include "json_tok.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Private types */
+typedef struct {
+    const char *p;                // next byte
+    const char *end;
+    json_doc_t *doc;
+} json_cursor_t;
+
+/* Private function prototypes */
+static json_err_t json_object(json_cursor_t *c);
+static json_err_t json_member(json_cursor_t *c);
+static void json_ws(json_cursor_t *c);
+static json_err_t json_string(json_cursor_t *c, json_value_t *v);
+static json_err_t json_number(json_cursor_t *c, json_value_t *v);
+static json_err_t json_literal(json_cursor_t *c, const char *word, json_type_t type, json_value_t *v);
+static json_err_t json_scalar(json_cursor_t *c, json_value_t *v);
+static json_err_t json_array(json_cursor_t *c, json_value_t *v);
+static uint8_t json_is_digit(const json_cursor_t *c);
+
+/**
+  * @brief  Tokenize one JSON object in a single pass, without copying
+  * @param  doc: Receives the members; strings point into text
+  * @param  text: Object, optionally surrounded by whitespace (need not be NUL-terminated)
+  * @param  len: Bytes in text
+  * @note   The whole input is validated against the JSON grammar (strict
+  *         numbers, string escapes, no control characters, nothing after the
+  *         object). Member values may be scalars or arrays of scalars.
+  * @retval JSON_OK, or the error with doc->err_pos set
+  */
+json_err_t json_parse(json_doc_t *doc, const char *text, size_t len)
+{
+    json_cursor_t c = { .p = text, .end = text + len, .doc = doc };
+    doc->members = 0;
+    doc->elems = 0;
+    json_ws(&c);
+    json_err_t err = json_object(&c);
+    if (err == JSON_OK) {
+        json_ws(&c);
+        if (c.p != c.end) {
+            err = JSON_ERR_SYNTAX;
+        }
+    }
+    doc->err_pos = (err == JSON_OK) ? 0 : (uint16_t)(c.p - text);
+    return err;
+}
+
+/**
+  * @brief  Find a member by exact key
+  * @param  doc: Parsed document
+  * @param  key: NUL-terminated key, compared whole (no escapes)
+  * @retval The value, or NULL if absent
+  */
+const json_value_t *json_get(const json_doc_t *doc, const char *key)
+{
+    size_t len = strlen(key);
+    for (uint8_t i = 0; i < doc->members; i++) {
+        const json_member_t *m = &doc->member[i];
+        if (m->key_len == len && memcmp(m->key, key, len) == 0) {
+            return &m->val;
+        }
+    }
+    return NULL;
+}
+
+/* At the opening brace */
+static json_err_t json_object(json_cursor_t *c)
+{
+    json_err_t err;
+    if (c->p == c->end || *c->p != '{') {
+        return JSON_ERR_SYNTAX;
+    }
+    c->p++;
+    json_ws(c);
+    if (c->p < c->end && *c->p == '}') {
+        c->p++;
+        return JSON_OK;
+    }
+    for (;;) {
+        if ((err = json_member(c)) != JSON_OK) {
+            return err;
+        }
+        json_ws(c);
+        if (c->p < c->end && *c->p == ',') {
+            c->p++;
+            json_ws(c);
+            continue;
+        }
+        if (c->p < c->end && *c->p == '}') {
+            c->p++;
+            return JSON_OK;
+        }
+        return JSON_ERR_SYNTAX;
+    }
+}
+
+/* "key": value */
+static json_err_t json_member(json_cursor_t *c)
+{
+    json_doc_t *doc = c->doc;
+    json_value_t key;
+    json_err_t err;
+    const char *key_at = c->p;
+
+    if (c->p == c->end || *c->p != '"') {
+        return JSON_ERR_SYNTAX;
+    }
+    if ((err = json_string(c, &key)) != JSON_OK) {
+        return err;
+    }
+    for (uint8_t i = 0; i < doc->members; i++) {
+        if (doc->member[i].key_len == key.len && memcmp(doc->member[i].key, key.str, key.len) == 0) {
+            c->p = key_at;
+            return JSON_ERR_DUPLICATE;
+        }
+    }
+    if (doc->members >= JSON_MAX_MEMBERS) {
+        c->p = key_at;
+        return JSON_ERR_LIMIT;
+    }
+    json_ws(c);
+    if (c->p == c->end || *c->p != ':') {
+        return JSON_ERR_SYNTAX;
+    }
+    c->p++;
+    json_ws(c);
+
+    json_member_t *m = &doc->member[doc->members];
+    err = (c->p < c->end && *c->p == '[') ? json_array(c, &m->val) : json_scalar(c, &m->val);
+    if (err != JSON_OK) {
+        return err;
+    }
+    m->key = key.str;
+    m->key_len = key.len;
+    doc->members++;
+    return JSON_OK;
+}
+
+static void json_ws(json_cursor_t *c)
+{
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\r' || *c->p == '\n')) {
+        c->p++;
+    }
+}
+
+static uint8_t json_is_digit(const json_cursor_t *c)
+{
+    return c->p < c->end && *c->p >= '0' && *c->p <= '9';
+}
+
+/* At the opening quote */
+static json_err_t json_string(json_cursor_t *c, json_value_t *v)
+{
+    c->p++;
+    v->type = JSON_STRING;
+    v->str = c->p;
+    v->escaped = 0;
+    while (c->p < c->end && *c->p != '"') {
+        uint8_t ch = (uint8_t)*c->p;
+        if (ch < 0x20) {
+            return JSON_ERR_SYNTAX;
+        }
+        if (ch == '\\') {
+            v->escaped = 1;
+            c->p++;
+            if (c->p == c->end) {
+                return JSON_ERR_SYNTAX;
+            }
+            if (*c->p == 'u') {
+                for (uint8_t i = 0; i < 4; i++) {
+                    c->p++;
+                    if (c->p == c->end || strchr("0123456789abcdefABCDEF", *c->p) == NULL) {
+                        return JSON_ERR_SYNTAX;
+                    }
+                }
+            } else if (strchr("\"\\/bfnrt", *c->p) == NULL) {
+                return JSON_ERR_SYNTAX;
+            }
+        }
+        c->p++;
+    }
+    if (c->p == c->end) {
+        return JSON_ERR_SYNTAX;
+    }
+    v->len = (uint16_t)(c->p - v->str);
+    c->p++;
+    return JSON_OK;
+}
+
+/* -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?, converted once it is known to be well formed */
+static json_err_t json_number(json_cursor_t *c, json_value_t *v)
+{
+    const char *start = c->p;
+    if (*c->p == '-') {
+        c->p++;
+    }
+    if (!json_is_digit(c)) {
+        return JSON_ERR_SYNTAX;
+    }
+    if (*c->p == '0') {
+        c->p++;
+    } else {
+        while (json_is_digit(c)) c->p++;
+    }
+    if (c->p < c->end && *c->p == '.') {
+        c->p++;
+        if (!json_is_digit(c)) {
+            return JSON_ERR_SYNTAX;
+        }
+        while (json_is_digit(c)) c->p++;
+    }
+    if (c->p < c->end && (*c->p == 'e' || *c->p == 'E')) {
+        c->p++;
+        if (c->p < c->end && (*c->p == '+' || *c->p == '-')) {
+            c->p++;
+        }
+        if (!json_is_digit(c)) {
+            return JSON_ERR_SYNTAX;
+        }
+        while (json_is_digit(c)) c->p++;
+    }
+    // The text need not be terminated: convert a bounded copy
+    char buf[32];
+    size_t n = (size_t)(c->p - start);
+    if (n >= sizeof(buf)) {
+        c->p = start;
+        return JSON_ERR_LIMIT;
+    }
+    memcpy(buf, start, n);
+    buf[n] = '\0';
+    v->type = JSON_NUMBER;
+    v->num = strtod(buf, NULL);
+    return JSON_OK;
+}
+
+static json_err_t json_literal(json_cursor_t *c, const char *word, json_type_t type, json_value_t *v)
+{
+    size_t n = strlen(word);
+    if ((size_t)(c->end - c->p) < n || memcmp(c->p, word, n) != 0) {
+        return JSON_ERR_SYNTAX;
+    }
+    c->p += n;
+    v->type = type;
+    return JSON_OK;
+}
+
+static json_err_t json_scalar(json_cursor_t *c, json_value_t *v)
+{
+    if (c->p == c->end) {
+        return JSON_ERR_SYNTAX;
+    }
+    switch (*c->p) {
+    case '"': return json_string(c, v);
+    case 't': return json_literal(c, "true", JSON_TRUE, v);
+    case 'f': return json_literal(c, "false", JSON_FALSE, v);
+    case 'n': return json_literal(c, "null", JSON_NULL, v);
+    case '{':
+    case '[': return JSON_ERR_UNSUPPORTED;
+    default:  return json_number(c, v);
+    }
+}
+
+/* At the opening bracket; elements go to doc->elem */
+static json_err_t json_array(json_cursor_t *c, json_value_t *v)
+{
+    json_doc_t *doc = c->doc;
+    json_err_t err;
+    c->p++;
+    v->type = JSON_ARRAY;
+    v->first = doc->elems;
+    v->len = 0;
+    json_ws(c);
+    if (c->p < c->end && *c->p == ']') {
+        c->p++;
+        return JSON_OK;
+    }
+    for (;;) {
+        if (doc->elems >= JSON_MAX_ELEMENTS) {
+            return JSON_ERR_LIMIT;
+        }
+        if ((err = json_scalar(c, &doc->elem[doc->elems])) != JSON_OK) {
+            return err;
+        }
+        doc->elems++;
+        v->len++;
+        json_ws(c);
+        if (c->p < c->end && *c->p == ',') {
+            c->p++;
+            json_ws(c);
+            continue;
+        }
+        if (c->p < c->end && *c->p == ']') {
+            c->p++;
+            return JSON_OK;
+        }
+        return JSON_ERR_SYNTAX;
+    }
+}
@@ -9,9 +9,14 @@
 /* Private variables */
 static LoadCell_Handle_t loadCell;
 static TaskHandle_t loadCellTaskHandle;
+static float calibKnownWeight;
 
 /* Private function prototypes */
 static void LoadCellTask_Function(void *argument);
+static void LoadCell_RequestDone(hx711_t *hx711, hx711_req_t req, int32_t average, float weight, void *arg);
+static void LoadCell_MuxSchedule(const hx711_sample_t *sample);
+static void LoadCell_ChannelUpdate(uint8_t ch, int32_t raw);
+static void LoadCell_Publish(void);
 
 /**
   * @brief  Initialize the load cell
@@ -22,22 +27,42 @@ void LoadCell_Init(void)
     /* Wait for system to stabilize */
     // HAL_Delay(100);
     
+#if LOADCELL_CHANNELS > 1
+    // Initialize HX711s sharing the clock line (ESP32)
+    const gpio_num_t dat_gpio[HX711_MULTI_MAX] = {
+        (gpio_num_t)CONFIG_HX711_DAT_GPIO, (gpio_num_t)CONFIG_HX711_DAT1_GPIO,
+        (gpio_num_t)CONFIG_HX711_DAT2_GPIO, (gpio_num_t)CONFIG_HX711_DAT3_GPIO
+    };
+    hx711_multi_init(&loadCell.multi, (gpio_num_t)CONFIG_HX711_CLK_GPIO, dat_gpio, LOADCELL_CHANNELS);
+#else
     // Initialize HX711 with GPIO pins (ESP32)
     hx711_init(&loadCell.hx711, (gpio_num_t)CONFIG_HX711_CLK_GPIO, (gpio_num_t)CONFIG_HX711_DAT_GPIO);
+#endif
     
     /* Wait for HX711 to stabilize */
     // HAL_Delay(100);
     
     /* Set default calibration factor */
     loadCell.calibration_factor = 200.0f;
+    for (int ch = 0; ch < LOADCELL_CHANNELS; ch++) {
+        loadCell.channel[ch].offset = 0;
+        loadCell.channel[ch].coef = loadCell.calibration_factor;
+        loadCell.channel[ch].tare_samples = 0;
+    }
     
-    /* Initialize moving average filter */
+    /* Initialize raw filter: 10-window moving average */
+    const filter_spec_t raw_filter = { .type = FILTER_MA, .window = 10 };
+    filter_chain_init(&loadCell.raw_filter, &raw_filter, 1);
+    filter_chain_set_integer(&loadCell.raw_filter);
     loadCell.last_raw_filtered = 0;
-    loadCell.filter_index = 0;
-    loadCell.filter_count = 0;
-    for (int i = 0; i < 10; i++) {
-        loadCell.filter_buffer[i] = 0;
-    }
+    
+    /* Channel A at gain 128 only until a mux ratio is set */
+    loadCell.gain_a = HX711_GAIN_A_128;
+    loadCell.mux_ratio_a = 0;
+    loadCell.mux_ratio_b = 1;
+    loadCell.mux_cur = HX711_GAIN_A_128;
+    loadCell.mux_next = HX711_GAIN_A_128;
+    loadCell.mux_valid = 0;
     
     /* Power cycle HX711 before setting coefficient */
     // hx711_power_down(&loadCell.hx711);
@@ -49,8 +74,8 @@ void LoadCell_Init(void)
     hx711_coef_set(&loadCell.hx711, loadCell.calibration_factor);
     LoadCell_Tare();
     
-    /* Create load cell task */
-    if (xTaskCreate(LoadCellTask_Function, "LoadCellTask", 5120, NULL, tskIDLE_PRIORITY+1, &loadCellTaskHandle) != pdPASS) {
+    /* Create load cell task (above the other services so DRDY is serviced promptly) */
+    if (xTaskCreate(LoadCellTask_Function, "LoadCellTask", 5120, NULL, tskIDLE_PRIORITY+2, &loadCellTaskHandle) != pdPASS) {
         UART_Printf("Load Cell Task Creation Failed\r\n");
         // fallthrough
     }
@@ -64,41 +89,378 @@ void LoadCell_Init(void)
   */
 float LoadCell_GetWeight(void)
 {
-    return loadCell.current_weight;
+    LoadCell_Sample_t s;
+    LoadCell_GetSnapshot(&s);
+    return s.weight;
 }
 
 int32_t LoadCell_GetRaw(void)
 {
-    return loadCell.last_raw;
+    LoadCell_Sample_t s;
+    LoadCell_GetSnapshot(&s);
+    return s.raw;
 }
 
 int32_t LoadCell_GetRawFiltered(void)
 {
-    return loadCell.last_raw_filtered;
+    LoadCell_Sample_t s;
+    LoadCell_GetSnapshot(&s);
+    return s.filtered;
+}
+
+/**
+  * @brief  esp_timer time (us) at which the last sample's conversion became ready
+  */
+int64_t LoadCell_GetTimestamp(void)
+{
+    LoadCell_Sample_t s;
+    LoadCell_GetSnapshot(&s);
+    return s.timestamp_us;
+}
+
+/**
+  * @brief  Sequence number of the last sample (increments once per conversion)
+  */
+uint32_t LoadCell_GetSequence(void)
+{
+    LoadCell_Sample_t s;
+    LoadCell_GetSnapshot(&s);
+    return s.seq;
+}
+
+/**
+  * @brief  Latest conversion as one consistent unit
+  * @param  snapshot: Out, raw/filtered/weight/timestamp/seq of the same conversion
+  * @note   Lock-free (sequence lock): retries if the load cell task published
+  *         while copying. Compare seq with the previous call to skip stale values.
+  * @retval None
+  */
+void LoadCell_GetSnapshot(LoadCell_Sample_t *snapshot)
+{
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&loadCell.snapshot_seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            continue;   // publish in progress
+        }
+        *snapshot = loadCell.snapshot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || __atomic_load_n(&loadCell.snapshot_seq, __ATOMIC_RELAXED) != seq);
+}
+
+/**
+  * @brief  Select the channel A gain (HX711_GAIN_A_128 or HX711_GAIN_A_64)
+  * @note   Applied by the load cell task; the next conversion on A settles first
+  * @retval 0 if the gain is invalid or devices share the clock (LOADCELL_CHANNELS > 1)
+  */
+uint8_t LoadCell_SetGain(hx711_gain_t gain_a)
+{
+#if LOADCELL_CHANNELS > 1
+    return 0;
+#else
+    if (gain_a != HX711_GAIN_A_128 && gain_a != HX711_GAIN_A_64) {
+        return 0;
+    }
+    loadCell.gain_a = gain_a;
+    return 1;
+#endif
+}
+
+/**
+  * @brief  Interleave channel B (gain 32) into the channel A stream
+  * @param  ratio_a: Settled channel A samples per visit (0 disables channel B)
+  * @param  ratio_b: Settled channel B samples per visit
+  * @retval 0 if devices share the clock (LOADCELL_CHANNELS > 1): no per-device channel switching
+  */
+uint8_t LoadCell_SetChannelMux(uint16_t ratio_a, uint16_t ratio_b)
+{
+#if LOADCELL_CHANNELS > 1
+    return 0;
+#else
+    loadCell.mux_ratio_b = (ratio_b > 0) ? ratio_b : 1;
+    loadCell.mux_ratio_a = ratio_a;
+    return 1;
+#endif
+}
+
+int32_t LoadCell_GetRawB(void)
+{
+    return loadCell.last_raw_b;
+}
+
+uint8_t LoadCell_GetChannelCount(void)
+{
+    return LOADCELL_CHANNELS;
+}
+
+int32_t LoadCell_GetChannelRaw(uint8_t ch)
+{
+    return (ch < LOADCELL_CHANNELS) ? loadCell.channel[ch].last_raw : 0;
+}
+
+float LoadCell_GetChannelWeight(uint8_t ch)
+{
+    return (ch < LOADCELL_CHANNELS) ? loadCell.channel[ch].weight : 0.0f;
+}
+
+/**
+  * @brief  Set the zero offset and scale of one load cell channel
+  * @param  ch: Channel index (0 .. LOADCELL_CHANNELS-1)
+  * @param  offset: Raw value at zero load
+  * @param  coef: Raw counts per unit weight
+  * @retval None
+  */
+void LoadCell_SetChannelCal(uint8_t ch, int32_t offset, float coef)
+{
+    if (ch >= LOADCELL_CHANNELS || coef == 0.0f) {
+        return;
+    }
+    loadCell.channel[ch].offset = offset;
+    loadCell.channel[ch].coef = coef;
+#if LOADCELL_CHANNELS == 1
+    loadCell.hx711.offset = offset;
+    loadCell.calibration_factor = coef;
+    hx711_coef_set(&loadCell.hx711, coef);
+#endif
+}
+
+/**
+  * @brief  Tare one load cell channel from its next 10 samples
+  * @param  ch: Channel index (0 .. LOADCELL_CHANNELS-1)
+  * @retval None
+  */
+void LoadCell_TareChannel(uint8_t ch)
+{
+#if LOADCELL_CHANNELS > 1
+    if (ch < LOADCELL_CHANNELS) {
+        loadCell.channel[ch].tare_count = 0;
+        loadCell.channel[ch].tare_sum = 0;
+        loadCell.channel[ch].tare_samples = 10;
+    }
+#else
+    if (ch == 0) {
+        LoadCell_Tare();
+    }
+#endif
+}
+
+/**
+  * @brief  Measured conversion period and DRDY-to-readout latency
+  * @param  interval: Out, DRDY-to-DRDY interval statistics (us)
+  * @param  latency: Out, DRDY-to-readout latency statistics (us)
+  * @retval None
+  */
+void LoadCell_GetStats(hx711_stat_t *interval, hx711_stat_t *latency)
+{
+#if LOADCELL_CHANNELS > 1
+    *interval = loadCell.multi.interval;
+    *latency = loadCell.multi.latency;
+#else
+    hx711_lock(&loadCell.hx711);
+    *interval = loadCell.hx711.interval;
+    *latency = loadCell.hx711.latency;
+    hx711_unlock(&loadCell.hx711);
+#endif
+}
+
+void LoadCell_ResetStats(void)
+{
+#if LOADCELL_CHANNELS > 1
+    hx711_multi_stats_reset(&loadCell.multi);
+#else
+    hx711_lock(&loadCell.hx711);
+    hx711_stats_reset(&loadCell.hx711);
+    hx711_unlock(&loadCell.hx711);
+#endif
 }
 
 /**
-  * @brief  Tare the load cell
+  * @brief  Take the oldest queued conversion
+  * @param  sample: Out, the conversion
+  * @note   Single consumer; every conversion is returned once, in order
+  * @retval 1 if a sample was returned, 0 if the queue is empty
+  */
+uint8_t LoadCell_PopSample(LoadCell_Sample_t *sample)
+{
+    uint32_t tail = loadCell.queue_tail;
+    if (tail == __atomic_load_n(&loadCell.queue_head, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    *sample = loadCell.queue[tail & (LOADCELL_QUEUE_LEN - 1)];
+    __atomic_store_n(&loadCell.queue_tail, tail + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/**
+  * @brief  Discard everything queued so far (consumer side)
+  */
+void LoadCell_FlushSamples(void)
+{
+    __atomic_store_n(&loadCell.queue_tail, __atomic_load_n(&loadCell.queue_head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+}
+
+uint32_t LoadCell_GetQueueOverruns(void)
+{
+    return loadCell.queue_overruns;
+}
+
+/**
+  * @brief  Filter chain behind LoadCell_GetRawFiltered()
+  * @note   Owned by the load cell task; reconfigure with filter_chain_request()
+  */
+filter_chain_t *LoadCell_GetRawFilter(void)
+{
+    return &loadCell.raw_filter;
+}
+
+/**
+  * @brief  Tare the load cell from the next 10 samples of the acquisition stream
+  * @note   Returns immediately; "Load Cell Tared" is printed on completion
   * @retval None
   */
 void LoadCell_Tare(void)
 {
-    hx711_tare(&loadCell.hx711, 10);
-    loadCell.tare_weight = hx711_weight(&loadCell.hx711, 10);
-    UART_Printf("Load Cell Tared\r\n");
+#if LOADCELL_CHANNELS > 1
+    for (uint8_t ch = 0; ch < LOADCELL_CHANNELS; ch++) {
+        LoadCell_TareChannel(ch);
+    }
+#else
+    if (!hx711_request(&loadCell.hx711, loadCell.gain_a, HX711_REQ_TARE, 10, LoadCell_RequestDone, NULL)) {
+        UART_Printf("Load Cell Busy\r\n");
+    }
+#endif
 }
 
 /**
   * @brief  Calibrate the load cell with known weight
   * @param  known_weight: Known weight in grams
+  * @note   Returns immediately; "Load Cell Calibrated" is printed on completion
   * @retval None
   */
 void LoadCell_Calibrate(float known_weight)
 {    
-    int32_t raw_value = hx711_value_ave(&loadCell.hx711, 10);
-    loadCell.calibration_factor = (float)raw_value / known_weight;
-    hx711_coef_set(&loadCell.hx711, loadCell.calibration_factor);
-    UART_Printf("Load Cell Calibrated\r\n");
+    calibKnownWeight = known_weight;
+#if LOADCELL_CHANNELS > 1
+    /* Per-channel scale is set with LoadCell_SetChannelCal() */
+    UART_Printf("Load Cell Calibration unavailable with %d channels\r\n", LOADCELL_CHANNELS);
+#else
+    if (!hx711_request(&loadCell.hx711, loadCell.gain_a, HX711_REQ_AVERAGE, 10, LoadCell_RequestDone, NULL)) {
+        UART_Printf("Load Cell Busy\r\n");
+    }
+#endif
+}
+
+/**
+  * @brief  Completion of an asynchronous tare/calibration request
+  * @note   Runs in the load cell task
+  */
+static void LoadCell_RequestDone(hx711_t *hx711, hx711_req_t req, int32_t average, float weight, void *arg)
+{
+    switch (req) {
+    case HX711_REQ_TARE:
+        loadCell.channel[0].offset = average;
+        /* Residual weight over the following samples, as the blocking tare reported */
+        (void)hx711_request(hx711, loadCell.gain_a, HX711_REQ_WEIGHT, 10, LoadCell_RequestDone, NULL);
+        break;
+    case HX711_REQ_WEIGHT:
+        loadCell.tare_weight = weight;
+        UART_Printf("Load Cell Tared\r\n");
+        break;
+    case HX711_REQ_AVERAGE:
+        loadCell.calibration_factor = (float)average / calibKnownWeight;
+        hx711_coef_set(hx711, loadCell.calibration_factor);
+        loadCell.channel[0].coef = loadCell.calibration_factor;
+        UART_Printf("Load Cell Calibrated\r\n");
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+  * @brief  Per-channel raw value, pending tare and weight
+  */
+static void LoadCell_ChannelUpdate(uint8_t ch, int32_t raw)
+{
+    LoadCell_Channel_t *c = &loadCell.channel[ch];
+    c->last_raw = raw;
+    if (c->tare_samples > 0) {
+        c->tare_sum += raw;
+        if (++c->tare_count >= c->tare_samples) {
+            c->offset = (int32_t)(c->tare_sum / c->tare_count);
+            c->tare_samples = 0;
+            UART_Printf("Load Cell %u Tared\r\n", (unsigned)ch);
+        }
+    }
+    c->weight = (float)(raw - c->offset) / c->coef;
+}
+
+/**
+  * @brief  Publish the sample just processed: snapshot, then consumer queue
+  * @note   The queue drops the new sample when the consumer has fallen a full
+  *         queue behind
+  */
+static void LoadCell_Publish(void)
+{
+    const LoadCell_Sample_t s = {
+        .raw = loadCell.last_raw,
+        .filtered = loadCell.last_raw_filtered,
+        .weight = loadCell.current_weight,
+        .timestamp_us = loadCell.last_timestamp_us,
+        .seq = loadCell.last_seq,
+    };
+    
+    /* Sequence lock: odd while the snapshot is being rewritten */
+    uint32_t seq = loadCell.snapshot_seq;
+    __atomic_store_n(&loadCell.snapshot_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    loadCell.snapshot = s;
+    __atomic_store_n(&loadCell.snapshot_seq, seq + 2, __ATOMIC_RELEASE);
+    
+    uint32_t head = loadCell.queue_head;
+    if (head - __atomic_load_n(&loadCell.queue_tail, __ATOMIC_ACQUIRE) >= LOADCELL_QUEUE_LEN) {
+        loadCell.queue_overruns++;
+        return;
+    }
+    loadCell.queue[head & (LOADCELL_QUEUE_LEN - 1)] = s;
+    __atomic_store_n(&loadCell.queue_head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+  * @brief  Pick the channel for the conversion after the one in flight
+  * @note   Selecting a channel at a readout only affects the conversion after
+  *         it, so the switch is made one sample early, counting the in-flight
+  *         conversion when it will already be settled.
+  */
+static void LoadCell_MuxSchedule(const hx711_sample_t *sample)
+{
+    if (sample->gain != loadCell.mux_cur) {
+        loadCell.mux_cur = sample->gain;
+        loadCell.mux_valid = 0;
+    }
+    if (!sample->settling) {
+        loadCell.mux_valid++;
+    }
+    /* A switch is already programmed; wait until it reaches the output */
+    if (loadCell.mux_next != sample->gain) {
+        return;
+    }
+    
+    hx711_gain_t want = loadCell.gain_a;
+    if (loadCell.mux_ratio_a > 0) {
+        uint8_t on_b = (sample->gain == HX711_GAIN_B_32);
+        uint16_t quota = on_b ? loadCell.mux_ratio_b : loadCell.mux_ratio_a;
+        uint16_t in_flight = (hx711_settling(&loadCell.hx711) == 0) ? 1 : 0;
+        if (loadCell.mux_valid + in_flight >= quota) {
+            want = on_b ? loadCell.gain_a : HX711_GAIN_B_32;
+        } else {
+            want = on_b ? HX711_GAIN_B_32 : loadCell.gain_a;
+        }
+    }
+    if (want != loadCell.mux_next) {
+        loadCell.mux_next = want;
+        hx711_set_gain(&loadCell.hx711, want);
+    }
 }
 
 /**
@@ -111,25 +473,62 @@ static void LoadCellTask_Function(void *argument)
     /* Initial delay to ensure system is stable */
     vTaskDelay(pdMS_TO_TICKS(100));
     
+#if _HX711_USE_DRDY_ISR && LOADCELL_CHANNELS == 1
+    if (hx711_drdy_start(&loadCell.hx711) != ESP_OK) {
+        UART_Printf("Load Cell DRDY interrupt unavailable, polling\r\n");
+    }
+#endif
+    
     for(;;)
     {
-        /* Read raw HX711 value */
-        int32_t raw = hx711_value(&loadCell.hx711);
-        loadCell.last_raw = raw;
-        
-        /* Apply 10-window moving average filter */
-        loadCell.filter_buffer[loadCell.filter_index] = raw;
-        loadCell.filter_index = (loadCell.filter_index + 1) % 10;
-        if (loadCell.filter_count < 10) loadCell.filter_count++;
+#if LOADCELL_CHANNELS > 1
+        /* One readout clocks every device; channel 0 continues below as the MDR stream */
+        hx711_multi_sample_t multi;
+        if (!hx711_multi_read(&loadCell.multi, &multi, 150)) {
+            continue;
+        }
+        for (uint8_t ch = 0; ch < LOADCELL_CHANNELS; ch++) {
+            LoadCell_ChannelUpdate(ch, multi.value[ch]);
+        }
+        hx711_sample_t sample = {
+            .value = multi.value[0],
+            .timestamp_us = multi.timestamp_us,
+            .seq = multi.seq,
+            .gain = HX711_GAIN_A_128,
+            .settling = 0,
+        };
+#else
+        /* Read one conversion (blocks until DOUT signals data ready) */
+        hx711_sample_t sample;
+        if (!hx711_read_sample(&loadCell.hx711, &sample, 150)) {
+            continue;
+        }
+        LoadCell_MuxSchedule(&sample);
         
-        /* Calculate filtered value */
-        int64_t sum = 0;
-        for (int i = 0; i < loadCell.filter_count; i++) {
-            sum += loadCell.filter_buffer[i];
+        /* Drop the conversion(s) straddling a channel/gain switch */
+        if (sample.settling) {
+            continue;
         }
-        loadCell.last_raw_filtered = (int32_t)(sum / loadCell.filter_count);
+        if (sample.gain == HX711_GAIN_B_32) {
+            loadCell.last_raw_b = sample.value;
+            loadCell.last_timestamp_b_us = sample.timestamp_us;
+            continue;
+        }
+        LoadCell_ChannelUpdate(0, sample.value);
+#endif
+        loadCell.current_weight = loadCell.channel[0].weight;
+        
+        int32_t raw = sample.value;
+        loadCell.last_raw = raw;
+        loadCell.last_timestamp_us = sample.timestamp_us;
+        loadCell.last_seq = sample.seq;
+        
+        /* Apply the raw filter chain */
+        loadCell.last_raw_filtered = (int32_t)filter_chain_apply(&loadCell.raw_filter, (double)raw);
+        LoadCell_Publish();
         
         // UART_Printf("mode%d : raw:%ld, filtered:%ld\r\n", mode, (long)raw, (long)loadCell.last_raw_filtered);
-        vTaskDelay(pdMS_TO_TICKS(16));
+        /* No sleep here in polled mode: hx711_read_sample already blocks (yielding
+           a tick at a time) until DOUT goes low, so a delay would drop conversions */
     }
 }
@@ -0,0 +1,135 @@
+#include "lockin.h"
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/**
+  * @brief  Start a new cycle
+  */
+void lockin_reset(lockin_t *li)
+{
+    li->n = 0;
+}
+
+/**
+  * @brief  Buffer one sample of the current cycle (dropped once the buffer is full)
+  */
+void lockin_add(lockin_t *li, int64_t t_us, double x)
+{
+    if (li->n == 0) {
+        li->t0_us = t_us;
+    }
+    if (li->n < LOCKIN_MAX_SAMPLES) {
+        li->dt_us[li->n] = (int32_t)(t_us - li->t0_us);
+        li->x[li->n] = (float)x;
+        li->n++;
+    }
+}
+
+/**
+  * @brief  Fit the buffered cycle as mean + S' sin(phi) + S'' cos(phi)
+  * @param  li: Buffered samples
+  * @param  ref_us: Time at which the strain reference phase is zero
+  * @param  ref_period_us: Oscillation period of the reference
+  * @param  phase_offset_deg: Added to the reference phase (die angle of the index)
+  * @param  out: Result
+  * @note   Least-squares three-parameter sine fit: the single-bin DFT made
+  *         exact for uneven sample spacing and windows that are not a whole
+  *         number of cycles. Uses every sample, so it is far less noise and
+  *         spike sensitive than (max - min) / 2.
+  * @retval 1 on success, 0 if there are too few samples or the fit is singular
+  */
+uint8_t lockin_solve(const lockin_t *li, int64_t ref_us, double ref_period_us, double phase_offset_deg, lockin_result_t *out)
+{
+    if (li->n < 4 || ref_period_us <= 0.0) {
+        return 0;
+    }
+
+    /* Normal equations for the basis {1, sin, cos} */
+    const double w = 2.0 * M_PI / ref_period_us;
+    const double p0 = w * (double)(li->t0_us - ref_us) + phase_offset_deg * (M_PI / 180.0);
+    double n = 0, ss = 0, sc = 0, s2 = 0, c2 = 0, scs = 0;
+    double y = 0, ys = 0, yc = 0;
+    for (uint16_t i = 0; i < li->n; i++) {
+        double ph = p0 + w * (double)li->dt_us[i];
+        double s = sin(ph), c = cos(ph), x = (double)li->x[i];
+        n += 1.0; ss += s; sc += c;
+        s2 += s * s; c2 += c * c; scs += s * c;
+        y += x; ys += x * s; yc += x * c;
+    }
+
+    /* Solve [n ss sc; ss s2 scs; sc scs c2] [m a b]' = [y ys yc]' by Cramer's rule */
+    double det = n * (s2 * c2 - scs * scs) - ss * (ss * c2 - scs * sc) + sc * (ss * scs - s2 * sc);
+    if (fabs(det) < 1e-9 * n * n * n) {
+        return 0;
+    }
+    double m = (y * (s2 * c2 - scs * scs) - ss * (ys * c2 - scs * yc) + sc * (ys * scs - s2 * yc)) / det;
+    double a = (n * (ys * c2 - scs * yc) - y * (ss * c2 - scs * sc) + sc * (ss * yc - ys * sc)) / det;
+    double b = (n * (s2 * yc - ys * scs) - ss * (ss * yc - ys * sc) + y * (ss * scs - s2 * sc)) / det;
+
+    out->mean = m;
+    out->s_prime = a;
+    out->s_dprime = b;
+    out->amp = hypot(a, b);
+    out->phase_deg = atan2(b, a) * (180.0 / M_PI);
+    out->tan_delta = (a != 0.0) ? b / a : 0.0;
+    out->samples = li->n;
+    return 1;
+}
+
+/**
+  * @brief  RMS and harmonic magnitudes of the buffered cycle
+  * @param  li: Buffered samples, spanning one oscillation period
+  * @param  period_us: Length of that period
+  * @param  out: Result
+  * @note   Direct DFT at the first LOCKIN_HARMONICS multiples of the cycle
+  *         frequency, evaluated at the sample times (one sin/cos per sample,
+  *         higher harmonics by angle-addition recurrence). The cycle mean is
+  *         removed first so an unclosed window does not leak DC into the
+  *         harmonics. Only meaningful when the buffer is a whole cycle.
+  * @retval 1 on success, 0 if there are too few samples
+  */
+uint8_t lockin_harmonics(const lockin_t *li, double period_us, lockin_harmonics_t *out)
+{
+    if (li->n < 2 * LOCKIN_HARMONICS + 1 || period_us <= 0.0) {
+        return 0;
+    }
+
+    double sum = 0.0, sum2 = 0.0;
+    for (uint16_t i = 0; i < li->n; i++) {
+        double x = (double)li->x[i];
+        sum += x;
+        sum2 += x * x;
+    }
+    const double n = (double)li->n;
+    const double mean = sum / n;
+
+    double re[LOCKIN_HARMONICS] = {0}, im[LOCKIN_HARMONICS] = {0};
+    const double w = 2.0 * M_PI / period_us;
+    for (uint16_t i = 0; i < li->n; i++) {
+        double x = (double)li->x[i] - mean;
+        double c1 = cos(w * (double)li->dt_us[i]), s1 = sin(w * (double)li->dt_us[i]);
+        double c = c1, s = s1;
+        for (uint8_t h = 0; h < LOCKIN_HARMONICS; h++) {
+            re[h] += x * c;
+            im[h] += x * s;
+            double cn = c * c1 - s * s1;
+            s = s * c1 + c * s1;
+            c = cn;
+        }
+    }
+
+    double harm2 = 0.0;
+    for (uint8_t h = 0; h < LOCKIN_HARMONICS; h++) {
+        out->mag[h] = 2.0 * hypot(re[h], im[h]) / n;
+        if (h > 0) {
+            harm2 += out->mag[h] * out->mag[h];
+        }
+    }
+    out->rms = sqrt(sum2 / n);
+    out->thd = (out->mag[0] > 0.0) ? sqrt(harm2) / out->mag[0] : 0.0;
+    out->samples = li->n;
+    return 1;
+}
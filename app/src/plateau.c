@@ -0,0 +1,94 @@
+#include "plateau.h"
+#include <math.h>
+
+/* Private function prototypes */
+static void plateau_drop_oldest(plateau_t *pl);
+
+/**
+  * @brief  Set the plateau criterion (clears the history)
+  * @param  pl: Detector
+  * @param  slope_per_min: Largest |dTorque/dt| counted as flat, N·m per minute (0 disables)
+  * @param  window_s: How long the slope must stay below it
+  * @retval None
+  */
+void plateau_config(plateau_t *pl, float slope_per_min, float window_s)
+{
+    pl->slope_per_min = slope_per_min;
+    pl->window_s = window_s;
+    plateau_reset(pl);
+}
+
+void plateau_reset(plateau_t *pl)
+{
+    pl->head = 0;
+    pl->count = 0;
+    pl->st = pl->sy = pl->stt = pl->sty = 0.0;
+    pl->t_ref = 0.0f;
+}
+
+/**
+  * @brief  Add one cycle of the filtered amplitude curve
+  * @param  pl: Detector
+  * @param  t_s: Time since the start of the run (s)
+  * @param  torque: Filtered cycle amplitude (N·m)
+  * @note   The slope is the least-squares fit over the points of the last
+  *         window_s, kept as running sums (O(1) per cycle). The window must be
+  *         (nearly) full, so a plateau means a flat fit over the whole window.
+  * @retval 1 once the plateau criterion is met
+  */
+uint8_t plateau_add(plateau_t *pl, float t_s, double torque)
+{
+    if (pl->slope_per_min <= 0.0f) {
+        return 0;
+    }
+    if (pl->count == 0) {
+        pl->t_ref = t_s;
+    }
+    while (pl->count > 0 && (pl->count == PLATEAU_MAX_POINTS ||
+           t_s - pl->t[(uint16_t)(pl->head + PLATEAU_MAX_POINTS - pl->count) % PLATEAU_MAX_POINTS] > pl->window_s)) {
+        plateau_drop_oldest(pl);
+    }
+
+    // Sum the stored (float) values, so plateau_drop_oldest() takes out exactly what went in
+    double t = (double)(t_s - pl->t_ref);
+    pl->t[pl->head] = t_s;
+    pl->y[pl->head] = (float)torque;
+    double y = (double)pl->y[pl->head];
+    pl->head = (uint16_t)((pl->head + 1) % PLATEAU_MAX_POINTS);
+    pl->count++;
+    pl->st += t;
+    pl->sy += y;
+    pl->stt += t * t;
+    pl->sty += t * y;
+
+    float oldest = pl->t[(uint16_t)(pl->head + PLATEAU_MAX_POINTS - pl->count) % PLATEAU_MAX_POINTS];
+    if (pl->count < 3 || t_s - oldest < 0.9f * pl->window_s) {
+        return 0;
+    }
+    return fabs(plateau_slope(pl)) * 60.0 < (double)pl->slope_per_min;
+}
+
+/**
+  * @brief  Fitted slope over the current window (N·m/s)
+  */
+double plateau_slope(const plateau_t *pl)
+{
+    double n = (double)pl->count;
+    double den = n * pl->stt - pl->st * pl->st;
+    if (pl->count < 2 || den <= 0.0) {
+        return 0.0;
+    }
+    return (n * pl->sty - pl->st * pl->sy) / den;
+}
+
+static void plateau_drop_oldest(plateau_t *pl)
+{
+    uint16_t i = (uint16_t)(pl->head + PLATEAU_MAX_POINTS - pl->count) % PLATEAU_MAX_POINTS;
+    double t = (double)(pl->t[i] - pl->t_ref);
+    double y = (double)pl->y[i];
+    pl->st -= t;
+    pl->sy -= y;
+    pl->stt -= t * t;
+    pl->sty -= t * y;
+    pl->count--;
+}
@@ -0,0 +1,152 @@
+#include "sdft.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Private function prototypes */
+static void sdft_twiddles(sdft_t *sd, uint16_t window);
+
+/**
+  * @brief  Configure a sliding DFT tuned to one cycle per window
+  * @param  sd: Instance
+  * @param  window: Samples per oscillation period (2 .. SDFT_MAX_WINDOW)
+  * @note   Builds the twiddle table and clears the window, so it belongs at
+  *         configuration time; sdft_retune() follows a frequency change.
+  * @retval 1 on success, 0 if window is out of range (instance unchanged)
+  */
+uint8_t sdft_init(sdft_t *sd, uint16_t window)
+{
+    if (window < 2 || window > SDFT_MAX_WINDOW) {
+        return 0;
+    }
+    sdft_twiddles(sd, window);
+    sdft_reset(sd);
+    return 1;
+}
+
+/**
+  * @brief  Change the window length, keeping the signal
+  * @param  sd: Instance
+  * @param  window: New samples per period (2 .. SDFT_MAX_WINDOW)
+  * @note   The sample rate is unchanged, so the newest samples carry over; a
+  *         longer window is completed from the old period (the signal is
+  *         periodic). The amplitude stays available across the change. One
+  *         pass over the window, no trigonometry per slot.
+  * @retval 1 on success, 0 if window is out of range (instance unchanged)
+  */
+uint8_t sdft_retune(sdft_t *sd, uint16_t window)
+{
+    if (window < 2 || window > SDFT_MAX_WINDOW) {
+        return 0;
+    }
+    const uint16_t n_old = sd->n;
+    if (n_old == 0 || sd->count < n_old) {
+        return sdft_init(sd, window);   // nothing worth keeping yet
+    }
+
+    /* Oldest first into wr[], which is rebuilt below anyway */
+    uint16_t m = sd->index;
+    for (uint16_t k = 0; k < n_old; k++) {
+        sd->wr[k] = sd->x[m];
+        if (++m >= n_old) {
+            m = 0;
+        }
+    }
+    int32_t k = (int32_t)n_old - (int32_t)window;
+    while (k < 0) {
+        k += n_old;
+    }
+    for (uint16_t j = 0; j < window; j++) {
+        sd->x[j] = sd->wr[k];
+        if (++k >= n_old) {
+            k = 0;
+        }
+    }
+
+    sdft_twiddles(sd, window);
+    sd->index = 0;
+    sd->count = window;
+    sd->sr = sd->si = 0.0;
+    for (uint16_t j = 0; j < window; j++) {
+        sd->sr += (double)sd->x[j] * sd->wr[j];
+        sd->si += (double)sd->x[j] * sd->wi[j];
+    }
+    sd->fr = sd->fi = 0.0;
+    return 1;
+}
+
+void sdft_reset(sdft_t *sd)
+{
+    memset(sd->x, 0, sizeof(sd->x));
+    sd->index = 0;
+    sd->count = 0;
+    sd->sr = sd->si = 0.0;
+    sd->fr = sd->fi = 0.0;
+}
+
+/**
+  * @brief  Slide the window by one sample
+  * @note   The sample leaving the window has the same twiddle as the one
+  *         entering it, so S += (x_new - x_old) * w[m]. Alongside, the new
+  *         sample's term is summed into F; when the slots wrap F holds the
+  *         whole window computed without subtractions and replaces S, so
+  *         rounding cannot accumulate. Every sample costs the same: two table
+  *         lookups and four multiply-adds. The DC level cancels over a whole
+  *         period.
+  * @retval Fundamental amplitude (0 until the window has filled)
+  */
+double sdft_update(sdft_t *sd, double x)
+{
+    if (sd->n == 0) {
+        return 0.0;
+    }
+    const uint16_t m = sd->index;
+    const float xn = (float)x;      // stored precision, so it leaves S exactly as it entered
+    double d = (double)xn - (double)sd->x[m];
+    sd->x[m] = xn;
+    sd->sr += d * sd->wr[m];
+    sd->si += d * sd->wi[m];
+    sd->fr += (double)xn * sd->wr[m];
+    sd->fi += (double)xn * sd->wi[m];
+
+    if (++sd->index >= sd->n) {
+        sd->index = 0;
+        sd->sr = sd->fr;
+        sd->si = sd->fi;
+        sd->fr = sd->fi = 0.0;
+    }
+    if (sd->count < sd->n) {
+        sd->count++;
+    }
+    return sdft_amplitude(sd);
+}
+
+/**
+  * @brief  Fundamental amplitude over the last window (0 until it has filled)
+  */
+double sdft_amplitude(const sdft_t *sd)
+{
+    if (sd->n == 0 || sd->count < sd->n) {
+        return 0.0;
+    }
+    return 2.0 * hypot(sd->sr, sd->si) / (double)sd->n;
+}
+
+/* e^(-j 2 pi m / window) by rotation: one sin/cos pair per table */
+static void sdft_twiddles(sdft_t *sd, uint16_t window)
+{
+    const double cr = cos(2.0 * M_PI / (double)window);
+    const double ci = -sin(2.0 * M_PI / (double)window);
+    double r = 1.0, i = 0.0;
+    for (uint16_t m = 0; m < window; m++) {
+        sd->wr[m] = (float)r;
+        sd->wi[m] = (float)i;
+        double t = r * cr - i * ci;
+        i = r * ci + i * cr;
+        r = t;
+    }
+    sd->n = window;
+}
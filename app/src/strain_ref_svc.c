@@ -0,0 +1,71 @@
+#include "strain_ref_svc.h"
+#include "balaji_infotech_machine_controller_v1.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+
+/*
+  Die position index: one rising edge per oscillation at a fixed die angle.
+  The edge times give the strain phase of any sample, so the torque can be
+  split into its elastic (in phase) and viscous (90 deg) parts.
+*/
+
+/* Private variables */
+static volatile int64_t refIndexUs;
+static volatile int64_t refPeriodUs;
+static volatile uint32_t refSeq;            // odd while the ISR updates the pair
+
+#if CONFIG_MDR_REF_GPIO >= 0
+static void IRAM_ATTR StrainRef_Isr(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    refSeq++;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    if (refIndexUs != 0) {
+        refPeriodUs = now - refIndexUs;
+    }
+    refIndexUs = now;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    refSeq++;
+}
+#endif
+
+/**
+  * @brief  Start capturing the die index input (no-op when not fitted)
+  * @retval None
+  */
+void StrainRef_Init(void)
+{
+#if CONFIG_MDR_REF_GPIO >= 0
+    const gpio_config_t io = {
+        .pin_bit_mask = 1ULL << CONFIG_MDR_REF_GPIO,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_POSEDGE,
+    };
+    gpio_config(&io);
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err == ESP_OK || err == ESP_ERR_INVALID_STATE) {
+        gpio_isr_handler_add((gpio_num_t)CONFIG_MDR_REF_GPIO, StrainRef_Isr, NULL);
+    }
+#endif
+}
+
+/**
+  * @brief  Latest die index edge and the oscillation period before it
+  * @param  index_us: Out, esp_timer time of the last index edge
+  * @param  period_us: Out, time between the last two edges
+  * @retval 1 if the reference is fitted and has seen two edges
+  */
+uint8_t StrainRef_Get(int64_t *index_us, int64_t *period_us)
+{
+    uint32_t seq;
+    do {
+        seq = refSeq;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        *index_us = refIndexUs;
+        *period_us = refPeriodUs;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != refSeq);
+    return *period_us > 0;
+}
@@ -0,0 +1,140 @@
+#include "sweep.h"
+#include "lockin.h"
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Private function prototypes */
+static void sweep_begin_step(sweep_t *sw, float t_s);
+static void sweep_finish_step(sweep_t *sw);
+
+/**
+  * @brief  Start a sweep
+  * @param  sw: Sweep
+  * @param  step: Frequency/dwell list (copied)
+  * @param  steps: Number of steps, at most SWEEP_MAX_STEPS
+  * @param  t_s: Current time (s)
+  * @retval None
+  */
+void sweep_start(sweep_t *sw, const sweep_step_t *step, uint8_t steps, float t_s)
+{
+    memset(sw, 0, sizeof(*sw));
+    if (steps > SWEEP_MAX_STEPS) {
+        steps = SWEEP_MAX_STEPS;
+    }
+    memcpy(sw->step, step, steps * sizeof(*step));
+    sw->steps = steps;
+    sweep_begin_step(sw, t_s);
+}
+
+/**
+  * @brief  Add one analyzer window of the current step
+  * @param  sw: Sweep
+  * @param  t_s: Start of the window on the sweep clock (s)
+  * @param  w: Window
+  * @note   Only locked windows with a quadrature fit that start after the
+  *         settling part of the dwell are averaged. S' and S'' are averaged
+  *         separately, so the phase average is not upset by wrap-around,
+  *         and only from windows referenced to the die index.
+  */
+void sweep_add(sweep_t *sw, float t_s, const cycle_window_t *w)
+{
+    if (sweep_done(sw) || !w->locked || !w->has_quad) {
+        return;
+    }
+    const sweep_step_t *st = &sw->step[sw->index];
+    if (t_s - sw->step_t0 < SWEEP_SETTLE_FRACTION * st->dwell_s) {
+        return;
+    }
+    sw->amp += w->quad.amp * w->cycles;
+    sw->freq += w->freq_hz * w->cycles;
+    sw->n += w->cycles;
+    if (w->quad_ref) {
+        sw->sp += w->quad.s_prime * w->cycles;
+        sw->sdp += w->quad.s_dprime * w->cycles;
+        sw->n_ref += w->cycles;
+    }
+}
+
+/**
+  * @brief  Advance the sweep clock
+  * @param  sw: Sweep
+  * @param  t_s: Current time (s), on the same clock as the sweep_add() window starts
+  * @retval Index of the step that just completed (its result is in table[]), -1 otherwise
+  * @note   Poll with the timestamp of each sample before it is analysed, so the
+  *         step boundary falls between conversions and none are lost or misfiled
+  */
+int sweep_poll(sweep_t *sw, float t_s)
+{
+    if (sweep_done(sw) || t_s - sw->step_t0 < sw->step[sw->index].dwell_s) {
+        return -1;
+    }
+    int done = sw->index;
+    sweep_finish_step(sw);
+    sw->index++;
+    if (!sweep_done(sw)) {
+        sweep_begin_step(sw, t_s);
+    }
+    return done;
+}
+
+uint8_t sweep_done(const sweep_t *sw)
+{
+    return sw->index >= sw->steps;
+}
+
+/**
+  * @brief  Step in progress, NULL when the sweep is finished
+  */
+const sweep_step_t *sweep_current(const sweep_t *sw)
+{
+    return sweep_done(sw) ? NULL : &sw->step[sw->index];
+}
+
+/**
+  * @brief  Frequencies the lock-in can follow at a conversion rate
+  * @param  sps: Measured conversions per second, 0 if not known yet
+  * @param  min_hz: Out, lowest frequency (one cycle fits LOCKIN_MAX_SAMPLES)
+  * @param  max_hz: Out, highest frequency (SWEEP_MIN_SAMPLES_CYCLE per cycle)
+  * @note   Never wider than SWEEP_MIN_HZ..SWEEP_MAX_HZ; an unknown rate gives that range
+  */
+void sweep_freq_range(double sps, float *min_hz, float *max_hz)
+{
+    *min_hz = SWEEP_MIN_HZ;
+    *max_hz = SWEEP_MAX_HZ;
+    if (sps > 0.0) {
+        *min_hz = fmaxf(*min_hz, (float)(sps / LOCKIN_MAX_SAMPLES));
+        *max_hz = fminf(*max_hz, (float)(sps / SWEEP_MIN_SAMPLES_CYCLE));
+    }
+}
+
+static void sweep_begin_step(sweep_t *sw, float t_s)
+{
+    sw->step_t0 = t_s;
+    sw->n = sw->n_ref = 0;
+    sw->amp = sw->sp = sw->sdp = sw->freq = 0.0;
+}
+
+static void sweep_finish_step(sweep_t *sw)
+{
+    sweep_point_t *p = &sw->table[sw->index];
+    memset(p, 0, sizeof(*p));
+    p->freq_hz = sw->step[sw->index].freq_hz;
+    p->cycles = sw->n;
+    if (sw->n == 0) {
+        return;
+    }
+    p->freq_meas = sw->freq / sw->n;
+    p->amp = sw->amp / sw->n;
+    if (sw->n_ref == 0) {
+        return;
+    }
+    p->ref_index = 1;
+    p->s_prime = sw->sp / sw->n_ref;
+    p->s_dprime = sw->sdp / sw->n_ref;
+    p->phase_deg = atan2(p->s_dprime, p->s_prime) * (180.0 / M_PI);
+    p->tan_delta = (p->s_prime != 0.0) ? p->s_dprime / p->s_prime : 0.0;
+}
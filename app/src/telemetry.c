@@ -0,0 +1,194 @@
+#include "telemetry.h"
+#include <string.h>
+#include "uart_tx_svc.h"
+
+#define TELEMETRY_RAW_MAX       (2 + TELEMETRY_TEXT_MAX + 2)                     // type, seq, payload, crc
+#define TELEMETRY_FRAME_MAX     (TELEMETRY_RAW_MAX + TELEMETRY_RAW_MAX / 254 + 2)  // COBS overhead and delimiter
+
+/* Private types */
+// Incremental COBS encoder: bytes go straight into the frame buffer
+typedef struct {
+    uint8_t *out;
+    size_t pos;                   // next output byte
+    size_t code_pos;              // where the current block's code byte goes
+    uint8_t code;
+    uint16_t crc;
+} telemetry_frame_t;
+
+/* Private variables */
+static volatile telemetry_format_t s_format = TELEMETRY_JSON;
+static uint8_t s_seq;                   // frame counter, taken atomically in frame_begin()
+
+/* Private function prototypes */
+static void frame_begin(telemetry_frame_t *f, uint8_t *buf, uint8_t type);
+static void frame_put(telemetry_frame_t *f, uint8_t b);
+static void frame_put_u16(telemetry_frame_t *f, uint16_t v);
+static void frame_put_u32(telemetry_frame_t *f, uint32_t v);
+static void frame_put_f32(telemetry_frame_t *f, float v);
+static void frame_send(telemetry_frame_t *f, uart_tx_lane_t lane);
+static void cobs_put(telemetry_frame_t *f, uint8_t b);
+
+/**
+  * @brief  Select the output format for this session (JSON after reset)
+  */
+void Telemetry_SetFormat(telemetry_format_t format)
+{
+    s_format = format;
+}
+
+telemetry_format_t Telemetry_GetFormat(void)
+{
+    return s_format;
+}
+
+/**
+  * @brief  Send a text record as a TELEMETRY_REC_TEXT frame
+  * @param  lane: Output priority of the text
+  * @param  text: Record (not NUL-terminated on the wire)
+  * @param  len: Length, truncated to TELEMETRY_TEXT_MAX
+  */
+void Telemetry_SendText(uart_tx_lane_t lane, const char *text, size_t len)
+{
+    uint8_t buf[TELEMETRY_FRAME_MAX];
+    telemetry_frame_t f;
+    if (len > TELEMETRY_TEXT_MAX) {
+        len = TELEMETRY_TEXT_MAX;
+    }
+    frame_begin(&f, buf, TELEMETRY_REC_TEXT);
+    for (size_t i = 0; i < len; i++) {
+        frame_put(&f, (uint8_t)text[i]);
+    }
+    frame_send(&f, lane);
+}
+
+void Telemetry_SendSample(const telemetry_sample_t *rec)
+{
+    uint8_t buf[64];
+    telemetry_frame_t f;
+    frame_begin(&f, buf, TELEMETRY_REC_SAMPLE);
+    frame_put(&f, rec->mode);
+    frame_put_u32(&f, rec->seq);
+    frame_put_u32(&f, (uint32_t)rec->t_us);
+    frame_put_u32(&f, (uint32_t)rec->raw);
+    frame_put_f32(&f, rec->torque);
+    frame_put_f32(&f, rec->amp_live);
+    frame_send(&f, UART_TX_BULK);
+}
+
+void Telemetry_SendCycle(const telemetry_cycle_t *rec)
+{
+    uint8_t buf[128];
+    telemetry_frame_t f;
+    frame_begin(&f, buf, TELEMETRY_REC_CYCLE);
+    frame_put(&f, rec->mode);
+    frame_put(&f, rec->flags);
+    frame_put(&f, rec->step);
+    frame_put_u32(&f, (uint32_t)rec->start_us);
+    frame_put_u32(&f, (uint32_t)rec->period_us);
+    frame_put_f32(&f, rec->amp);
+    frame_put_f32(&f, rec->amp_filtered);
+    frame_put_f32(&f, rec->min);
+    frame_put_f32(&f, rec->max);
+    frame_put_f32(&f, rec->freq_hz);
+    frame_put_f32(&f, rec->amp_fit);
+    frame_put_f32(&f, rec->phase_deg);
+    frame_put_f32(&f, rec->tan_delta);
+    frame_put_f32(&f, rec->rms);
+    frame_put_f32(&f, rec->thd);
+    for (uint8_t k = 0; k < 5; k++) {
+        frame_put_f32(&f, rec->harm[k]);
+    }
+    frame_send(&f, UART_TX_BULK);
+}
+
+void Telemetry_SendFit(const telemetry_fit_t *rec)
+{
+    uint8_t buf[64];
+    telemetry_frame_t f;
+    frame_begin(&f, buf, TELEMETRY_REC_FIT);
+    frame_put_f32(&f, rec->mh);
+    frame_put_f32(&f, rec->mh_ci_lo);
+    frame_put_f32(&f, rec->mh_ci_hi);
+    frame_put_f32(&f, rec->k);
+    frame_put_f32(&f, rec->t90);
+    frame_put_f32(&f, rec->t90_ci_lo);
+    frame_put_f32(&f, rec->t90_ci_hi);
+    frame_put_u16(&f, rec->points);
+    frame_send(&f, UART_TX_BULK);
+}
+
+/**
+  * @brief  CRC-16/CCITT-FALSE, bitwise (frames are short)
+  * @param  crc: 0xFFFF to start, or the running value
+  */
+uint16_t telemetry_crc16(uint16_t crc, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void frame_begin(telemetry_frame_t *f, uint8_t *buf, uint8_t type)
+{
+    f->out = buf;
+    f->code_pos = 0;
+    f->pos = 1;
+    f->code = 1;
+    f->crc = 0xFFFF;
+    frame_put(f, type);
+    // Several tasks send frames: every frame takes its own number
+    frame_put(f, __atomic_fetch_add(&s_seq, 1, __ATOMIC_RELAXED));
+}
+
+static void frame_put(telemetry_frame_t *f, uint8_t b)
+{
+    f->crc = telemetry_crc16(f->crc, &b, 1);
+    cobs_put(f, b);
+}
+
+static void frame_put_u16(telemetry_frame_t *f, uint16_t v)
+{
+    frame_put(f, (uint8_t)v);
+    frame_put(f, (uint8_t)(v >> 8));
+}
+
+static void frame_put_u32(telemetry_frame_t *f, uint32_t v)
+{
+    frame_put_u16(f, (uint16_t)v);
+    frame_put_u16(f, (uint16_t)(v >> 16));
+}
+
+static void frame_put_f32(telemetry_frame_t *f, float v)
+{
+    uint32_t u;
+    memcpy(&u, &v, sizeof(u));
+    frame_put_u32(f, u);
+}
+
+/* Append the CRC, close the last COBS block and queue the frame as one record */
+static void frame_send(telemetry_frame_t *f, uart_tx_lane_t lane)
+{
+    uint16_t crc = f->crc;
+    cobs_put(f, (uint8_t)crc);
+    cobs_put(f, (uint8_t)(crc >> 8));
+    f->out[f->code_pos] = f->code;
+    f->out[f->pos++] = 0x00;
+    (void)UartTx_Write(lane, f->out, f->pos);
+}
+
+static void cobs_put(telemetry_frame_t *f, uint8_t b)
+{
+    if (b != 0) {
+        f->out[f->pos++] = b;
+        f->code++;
+    }
+    if (b == 0 || f->code == 0xFF) {
+        f->out[f->code_pos] = f->code;
+        f->code_pos = f->pos++;
+        f->code = 1;
+    }
+}
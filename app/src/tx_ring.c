@@ -0,0 +1,180 @@
+#include "tx_ring.h"
+#include <string.h>
+
+#define TX_RING_HDR         4         // u16 length, u16 reserved
+#define TX_RING_PAD         0xFFFFu   // length of the filler record before a wrap
+#define TX_RING_RETRIES     16        // reservation attempts before giving up
+
+/* Private function prototypes */
+static uint32_t tx_ring_rec_size(uint32_t len);
+static uint32_t *tx_ring_stamp(tx_ring_t *ring, uint32_t pos);
+static void tx_ring_commit(tx_ring_t *ring, uint32_t pos, uint16_t len);
+static uint8_t tx_ring_drop_oldest(tx_ring_t *ring, uint32_t t);
+static uint32_t tx_ring_span(const tx_ring_t *ring, uint32_t pos, uint16_t *len);
+
+/**
+  * @brief  Initialize an empty ring
+  * @param  ring: Ring
+  * @param  buf: Data storage, 4-byte aligned
+  * @param  stamp: size / TX_RING_ALIGN words
+  * @param  size: Power of two, at least 2 * (TX_RING_MAX_RECORD + TX_RING_ALIGN)
+  * @param  policy: Overflow policy
+  * @retval None
+  */
+void tx_ring_init(tx_ring_t *ring, uint8_t *buf, uint32_t *stamp, uint32_t size, tx_ring_policy_t policy)
+{
+    memset(ring, 0, sizeof(*ring));
+    memset(stamp, 0, (size / TX_RING_ALIGN) * sizeof(*stamp));
+    ring->buf = buf;
+    ring->stamp = stamp;
+    ring->size = size;
+    ring->policy = policy;
+}
+
+/**
+  * @brief  Queue one record (any task; never blocks)
+  * @param  ring: Ring
+  * @param  data: Record bytes, kept together on output
+  * @param  len: 1..TX_RING_MAX_RECORD
+  * @note   Records never straddle the end of the buffer: a filler record
+  *         pads to the end first. When the ring is full, TX_DROP_OLDEST
+  *         discards committed records from the tail (racing the consumer
+  *         with a compare-and-swap, so each is either sent or dropped, never
+  *         both); TX_DROP_NEWEST, or an oldest record still being written,
+  *         rejects this one.
+  * @retval 1 if queued, 0 if dropped
+  */
+uint8_t tx_ring_write(tx_ring_t *ring, const void *data, size_t len)
+{
+    if (len > 0 && len <= TX_RING_MAX_RECORD) {
+        const uint32_t size = tx_ring_rec_size((uint32_t)len);
+        for (uint8_t attempt = 0; attempt < TX_RING_RETRIES; attempt++) {
+            // Tail first: head read afterwards is never behind it
+            uint32_t t = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+            uint32_t h = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+            uint32_t off = h & (ring->size - 1);
+            uint32_t pad = (off + size > ring->size) ? ring->size - off : 0;
+            if (pad + size > ring->size - (h - t)) {
+                if (ring->policy == TX_DROP_OLDEST && tx_ring_drop_oldest(ring, t)) {
+                    continue;
+                }
+                break;
+            }
+            if (!__atomic_compare_exchange_n(&ring->head, &h, h + pad + size, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                continue;   // another producer got there first
+            }
+            if (pad) {
+                tx_ring_commit(ring, h, TX_RING_PAD);
+            }
+            uint32_t p = h + pad;
+            memcpy(&ring->buf[(p & (ring->size - 1)) + TX_RING_HDR], data, len);
+            tx_ring_commit(ring, p, (uint16_t)len);
+            __atomic_fetch_add(&ring->stats.records, 1, __ATOMIC_RELAXED);
+            uint32_t used = p + size - t;
+            if (used > ring->stats.high_water) {
+                ring->stats.high_water = used;   // approximate under contention
+            }
+            return 1;
+        }
+    }
+    __atomic_fetch_add(&ring->stats.dropped_newest, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&ring->stats.dropped_bytes, (uint32_t)len, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/**
+  * @brief  Take the oldest record (single consumer)
+  * @param  ring: Ring
+  * @param  out: Receives the record
+  * @param  out_sz: At least TX_RING_MAX_RECORD
+  * @note   The record is copied out before it is released, so a drop-oldest
+  *         producer that wins the race for it leaves only a torn copy, which
+  *         is discarded.
+  * @retval Record length, 0 if the ring is empty or its oldest record is not committed yet
+  */
+size_t tx_ring_read(tx_ring_t *ring, void *out, size_t out_sz)
+{
+    for (;;) {
+        uint32_t t = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (t == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) ||
+            __atomic_load_n(tx_ring_stamp(ring, t), __ATOMIC_ACQUIRE) != t + 1) {
+            return 0;
+        }
+        uint16_t len;
+        uint32_t size = tx_ring_span(ring, t, &len);
+        // A header torn by a producer reusing the space is bounded: records never pass the end
+        const uint32_t off = t & (ring->size - 1);
+        size_t n = (len != TX_RING_PAD && len <= out_sz && len <= TX_RING_MAX_RECORD &&
+                    off + TX_RING_HDR + len <= ring->size) ? len : 0;
+        memcpy(out, &ring->buf[off + TX_RING_HDR], n);
+        uint16_t len_after;
+        memcpy(&len_after, &ring->buf[off], sizeof(len_after));
+        if (__atomic_load_n(tx_ring_stamp(ring, t), __ATOMIC_ACQUIRE) != t + 1 || len_after != len) {
+            continue;   // dropped and reused while we copied: start over from the new tail
+        }
+        if (__atomic_compare_exchange_n(&ring->tail, &t, t + size, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) && n > 0) {
+            return n;
+        }
+        // Filler, or dropped by a producer while we copied: next record
+    }
+}
+
+/**
+  * @brief  Bytes reserved and not yet released
+  */
+size_t tx_ring_used(const tx_ring_t *ring)
+{
+    uint32_t t = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - t;
+}
+
+void tx_ring_get_stats(const tx_ring_t *ring, tx_ring_stats_t *stats)
+{
+    *stats = ring->stats;
+}
+
+void tx_ring_reset_stats(tx_ring_t *ring)
+{
+    memset(&ring->stats, 0, sizeof(ring->stats));
+}
+
+static uint32_t tx_ring_rec_size(uint32_t len)
+{
+    return (TX_RING_HDR + len + TX_RING_ALIGN - 1) & ~(uint32_t)(TX_RING_ALIGN - 1);
+}
+
+static uint32_t *tx_ring_stamp(tx_ring_t *ring, uint32_t pos)
+{
+    return &ring->stamp[(pos & (ring->size - 1)) / TX_RING_ALIGN];
+}
+
+/* Header, then the stamp that publishes it (position + 1: never 0, never a previous lap's) */
+static void tx_ring_commit(tx_ring_t *ring, uint32_t pos, uint16_t len)
+{
+    memcpy(&ring->buf[pos & (ring->size - 1)], &len, sizeof(len));
+    __atomic_store_n(tx_ring_stamp(ring, pos), pos + 1, __ATOMIC_RELEASE);
+}
+
+/* Bytes taken by the committed record at pos */
+static uint32_t tx_ring_span(const tx_ring_t *ring, uint32_t pos, uint16_t *len)
+{
+    memcpy(len, &ring->buf[pos & (ring->size - 1)], sizeof(*len));
+    return (*len == TX_RING_PAD) ? ring->size - (pos & (ring->size - 1)) : tx_ring_rec_size(*len);
+}
+
+/* Release the record at tail t if it is committed; 1 if space may have been freed */
+static uint8_t tx_ring_drop_oldest(tx_ring_t *ring, uint32_t t)
+{
+    if (t == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) ||
+        __atomic_load_n(tx_ring_stamp(ring, t), __ATOMIC_ACQUIRE) != t + 1) {
+        return 0;   // empty, or the oldest record is still being written
+    }
+    uint16_t len;
+    uint32_t size = tx_ring_span(ring, t, &len);
+    if (__atomic_compare_exchange_n(&ring->tail, &t, t + size, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED) &&
+        len != TX_RING_PAD) {
+        __atomic_fetch_add(&ring->stats.dropped_oldest, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&ring->stats.dropped_bytes, len, __ATOMIC_RELAXED);
+    }
+    return 1;   // we or the consumer moved the tail
+}
@@ -0,0 +1,113 @@
+#include "uart_tx_svc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/uart.h"
+
+/*
+  All console output goes through preallocated rings, one per lane. Producers
+  (any task) copy a finished record in and return; only the output task ever
+  waits on the UART, so a busy link costs dropped records, not control-loop
+  timing. The output task takes one record at a time from the highest lane
+  that has one, and the UART driver is installed without a TX buffer, so a
+  reply waits behind at most the single record already on the wire.
+*/
+
+#define UART_TX_PORT        UART_NUM_0
+#define UART_TX_IDLE_MS     20        // drain period when no producer has signalled
+
+/* Private variables */
+static uint8_t responseBuf[4096] __attribute__((aligned(4)));
+static uint8_t eventBuf[4096] __attribute__((aligned(4)));
+static uint8_t bulkBuf[8192] __attribute__((aligned(4)));
+static uint32_t responseStamp[sizeof(responseBuf) / TX_RING_ALIGN];
+static uint32_t eventStamp[sizeof(eventBuf) / TX_RING_ALIGN];
+static uint32_t bulkStamp[sizeof(bulkBuf) / TX_RING_ALIGN];
+
+// Statically set up (drop newest) so records queued before UartTx_Init are kept
+static tx_ring_t txLane[UART_TX_LANES] = {
+    [UART_TX_RESPONSE] = { .buf = responseBuf, .stamp = responseStamp, .size = sizeof(responseBuf) },
+    [UART_TX_EVENT]    = { .buf = eventBuf,    .stamp = eventStamp,    .size = sizeof(eventBuf) },
+    [UART_TX_BULK]     = { .buf = bulkBuf,     .stamp = bulkStamp,     .size = sizeof(bulkBuf) },
+};
+static TaskHandle_t uartTxTaskHandle;
+static uint8_t txRecord[TX_RING_MAX_RECORD];
+
+/* Private function prototypes */
+static void UartTxTask_Function(void *argument);
+
+/**
+  * @brief  Start the output task (after the UART driver is installed)
+  * @note   Records queued earlier are kept and sent first
+  * @retval None
+  */
+void UartTx_Init(void)
+{
+    if (xTaskCreate(UartTxTask_Function, "UartTxTask", 3072, NULL, tskIDLE_PRIORITY+1, &uartTxTaskHandle) != pdPASS) {
+        uartTxTaskHandle = NULL;
+    }
+}
+
+/**
+  * @brief  Queue one record for output (never blocks)
+  * @param  lane: Priority lane
+  * @param  data: Record bytes, written out contiguously
+  * @param  len: Up to TX_RING_MAX_RECORD
+  * @retval 1 if queued, 0 if dropped by the lane's overflow policy
+  */
+uint8_t UartTx_Write(uart_tx_lane_t lane, const void *data, size_t len)
+{
+    uint8_t ok = tx_ring_write(&txLane[lane], data, len);
+    if (ok && uartTxTaskHandle != NULL) {
+        xTaskNotifyGive(uartTxTaskHandle);
+    }
+    return ok;
+}
+
+void UartTx_SetPolicy(uart_tx_lane_t lane, tx_ring_policy_t policy)
+{
+    txLane[lane].policy = policy;
+}
+
+tx_ring_policy_t UartTx_GetPolicy(uart_tx_lane_t lane)
+{
+    return txLane[lane].policy;
+}
+
+void UartTx_GetStats(uart_tx_lane_t lane, tx_ring_stats_t *stats)
+{
+    tx_ring_get_stats(&txLane[lane], stats);
+}
+
+uint32_t UartTx_GetSize(uart_tx_lane_t lane)
+{
+    return txLane[lane].size;
+}
+
+void UartTx_ResetStats(void)
+{
+    for (uint8_t i = 0; i < UART_TX_LANES; i++) {
+        tx_ring_reset_stats(&txLane[i]);
+    }
+}
+
+/**
+  * @brief  Output task: send queued records, highest lane first
+  * @param  argument: Not used
+  * @retval None
+  */
+static void UartTxTask_Function(void *argument)
+{
+    while (1) {
+        (void)ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(UART_TX_IDLE_MS));
+        uint8_t lane = 0;
+        while (lane < UART_TX_LANES) {
+            size_t n = tx_ring_read(&txLane[lane], txRecord, sizeof(txRecord));
+            if (n == 0) {
+                lane++;
+                continue;
+            }
+            uart_write_bytes(UART_TX_PORT, txRecord, n);
+            lane = 0;   // re-check the higher lanes after every record
+        }
+    }
+}
@@ -28,23 +28,129 @@ extern "C" {
 #include <stdint.h>
 #ifdef ESP_PLATFORM
 #include "driver/gpio.h"
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #else
 typedef int gpio_num_t;
+typedef int esp_err_t;
+typedef void *TaskHandle_t;
+#define ESP_OK                  0
+#define ESP_ERR_NOT_SUPPORTED   0x106
 #endif
 #include <stdint.h>
 
 //####################################################################################################################
 
+// Channel/gain, encoded as the number of PD_SCK pulses that selects it
+typedef enum
+{
+  HX711_GAIN_A_128 = 25,
+  HX711_GAIN_B_32  = 26,
+  HX711_GAIN_A_64  = 27,
+  
+}hx711_gain_t;
+
+typedef struct
+{
+  int32_t       value;
+  int64_t       timestamp_us;     // esp_timer time of the DOUT falling edge (data ready)
+  uint32_t      seq;              // increments once per conversion read
+  hx711_gain_t  gain;             // channel/gain this conversion was taken with
+  uint8_t       settling;         // 1: within _HX711_SETTLE_CONVERSIONS of a channel/gain switch
+  
+}hx711_sample_t;
+
+typedef enum
+{
+  HX711_REQ_NONE = 0,
+  HX711_REQ_AVERAGE,              // mean raw value
+  HX711_REQ_TARE,                 // mean raw value, stored as offset
+  HX711_REQ_WEIGHT,               // mean raw value, scaled by offset/coef
+  
+}hx711_req_t;
+
+// Running statistics (Welford) of a time interval in microseconds
 typedef struct
+{
+  uint32_t      count;
+  int64_t       min_us;
+  int64_t       max_us;
+  double        mean_us;
+  double        m2;               // sum of squared deviations from the mean
+  
+}hx711_stat_t;
+
+struct hx711_s;
+typedef void (*hx711_done_cb_t)(struct hx711_s *hx711, hx711_req_t req, int32_t average, float weight, void *arg);
+
+typedef struct hx711_s
 {
   gpio_num_t    clk_gpio;
   gpio_num_t    dat_gpio;
   int32_t       offset;
   float         coef;
+#ifdef ESP_PLATFORM
+  SemaphoreHandle_t mutex;
+  StaticSemaphore_t mutex_buf;
+#else
   uint8_t       lock;    
+#endif
+  void          *port;            // backend-private state (see hx711_port.h)
+  
+  // Data-ready interrupt acquisition
+  TaskHandle_t  drdy_task;
+  volatile int64_t drdy_time_us;
+  uint32_t      seq;
+  
+  // Conversion period (DRDY to DRDY) and DRDY-to-readout latency
+  hx711_stat_t  interval;
+  hx711_stat_t  latency;
+  int64_t       last_time_us;
+  
+  // Channel/gain of the conversion in progress, and the one selected for the next
+  hx711_gain_t  gain;
+  hx711_gain_t  gain_next;
+  uint8_t       settle;
+  
+  // Asynchronous average/tare/weight, fed by hx711_read_sample()
+  hx711_req_t   req;
+  hx711_gain_t  req_gain;
+  uint16_t      req_samples;
+  uint16_t      req_count;
+  int64_t       req_sum;
+  hx711_done_cb_t req_cb;
+  void          *req_arg;
   
 }hx711_t;
 
+// Several HX711s sharing one PD_SCK line, read in lockstep (GPIO bit-bang, ESP only)
+#define HX711_MULTI_MAX   4
+
+typedef struct
+{
+  int32_t       value[HX711_MULTI_MAX];
+  int64_t       timestamp_us;     // esp_timer time at which every DOUT was first seen low
+  uint32_t      seq;
+  
+}hx711_multi_sample_t;
+
+typedef struct
+{
+  gpio_num_t    clk_gpio;
+  gpio_num_t    dat_gpio[HX711_MULTI_MAX];
+  uint8_t       count;
+  uint32_t      mask_lo;          // DOUT bits in GPIO_IN_REG  (GPIO0..31)
+  uint32_t      mask_hi;          // DOUT bits in GPIO_IN1_REG (GPIO32..39)
+  hx711_gain_t  gain;             // shared clock: one channel/gain for all devices
+  uint32_t      seq;
+  hx711_stat_t  interval;
+  hx711_stat_t  latency;
+  int64_t       last_time_us;
+  
+}hx711_multi_t;
+
 //####################################################################################################################
 
 void        hx711_init(hx711_t *hx711, gpio_num_t clk_gpio, gpio_num_t dat_gpio);
@@ -53,6 +159,26 @@ void        hx711_unlock(hx711_t *hx711);
 int32_t     hx711_value(hx711_t *hx711);
 int32_t     hx711_value_ave(hx711_t *hx711, uint16_t sample);
 
+esp_err_t   hx711_drdy_start(hx711_t *hx711);
+void        hx711_drdy_stop(hx711_t *hx711);
+uint8_t     hx711_read_sample(hx711_t *hx711, hx711_sample_t *sample, uint32_t timeout_ms);
+
+void        hx711_stat_reset(hx711_stat_t *stat);
+void        hx711_stat_add(hx711_stat_t *stat, int64_t us);
+double      hx711_stat_stddev(const hx711_stat_t *stat);
+void        hx711_stats_reset(hx711_t *hx711);
+
+// Selected at the next readout; the conversion after that one uses the new channel/gain
+void        hx711_set_gain(hx711_t *hx711, hx711_gain_t gain);
+hx711_gain_t hx711_get_gain(hx711_t *hx711);
+uint8_t     hx711_settling(hx711_t *hx711);
+
+// Non-blocking: averages the next 'sample' settled conversions on 'gain' read by
+// hx711_read_sample() and calls cb from the reading task. Returns 0 if a request is pending.
+uint8_t     hx711_request(hx711_t *hx711, hx711_gain_t gain, hx711_req_t req, uint16_t sample, hx711_done_cb_t cb, void *arg);
+uint8_t     hx711_request_pending(hx711_t *hx711);
+
+// Blocking: hold the driver for 'sample' x (conversion + 5 ms); use hx711_request() once streaming
 void        hx711_coef_set(hx711_t *hx711, float coef);
 float       hx711_coef_get(hx711_t *hx711);
 void        hx711_calibration(hx711_t *hx711, int32_t value_noload, int32_t value_load, float scale);
@@ -61,6 +187,13 @@ float       hx711_weight(hx711_t *hx711, uint16_t sample);
 void        hx711_power_down(hx711_t *hx711);
 void        hx711_power_up(hx711_t *hx711);
 
+#ifdef ESP_PLATFORM
+// Single reader only; no DRDY interrupt (conversions are read once all DOUT lines are low)
+void        hx711_multi_init(hx711_multi_t *multi, gpio_num_t clk_gpio, const gpio_num_t *dat_gpio, uint8_t count);
+uint8_t     hx711_multi_read(hx711_multi_t *multi, hx711_multi_sample_t *sample, uint32_t timeout_ms);
+void        hx711_multi_stats_reset(hx711_multi_t *multi);
+#endif
+
 //####################################################################################################################
 
 #ifdef __cplusplus
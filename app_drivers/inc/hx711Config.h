@@ -2,8 +2,31 @@
 #define _HX711CONFIG_H_
 
 #define		_HX711_USE_FREERTOS		1
+
+// Readout backend (override with -D_HX711_BACKEND=...)
+#define   HX711_BACKEND_GPIO    0   // bit-banged PD_SCK
+#define   HX711_BACKEND_SPI     1   // PD_SCK/DOUT clocked by an SPI host
+#define   HX711_BACKEND_MOCK    2   // host-side scripted conversions
+#define   HX711_BACKEND_REPLAY  3   // host-side playback of recorded CSV logs
+#ifndef _HX711_BACKEND
+#ifdef ESP_PLATFORM
+#define   _HX711_BACKEND        HX711_BACKEND_GPIO
+#else
+#define   _HX711_BACKEND        HX711_BACKEND_MOCK
+#endif
+#endif
  #define   _HX711_DELAY_US_LOOP  2
 
+// 1: read each conversion on the DOUT falling edge (data-ready interrupt)
+// 0: poll DOUT from the acquisition task
+#define   _HX711_USE_DRDY_ISR   1
+
+// Conversions flagged as settling after a channel/gain switch
+// (datasheet settling time is 4 output periods; 1 discards the mixed conversion)
+#ifndef _HX711_SETTLE_CONVERSIONS
+#define   _HX711_SETTLE_CONVERSIONS   1
+#endif
+
 // ESP32 GPIO pins
 #ifndef CONFIG_HX711_CLK_GPIO
 #define CONFIG_HX711_CLK_GPIO  2   // CLK -> IO2
@@ -12,4 +35,26 @@
 #define CONFIG_HX711_DAT_GPIO  15  // DOUT -> IO15
 #endif
 
+// HX711s sharing CONFIG_HX711_CLK_GPIO (1 = single device on CONFIG_HX711_DAT_GPIO)
+#ifndef CONFIG_HX711_DEVICES
+#define CONFIG_HX711_DEVICES   1
+#endif
+#ifndef CONFIG_HX711_DAT1_GPIO
+#define CONFIG_HX711_DAT1_GPIO  4   // DOUT of device 1 -> IO4
+#endif
+#ifndef CONFIG_HX711_DAT2_GPIO
+#define CONFIG_HX711_DAT2_GPIO  16  // DOUT of device 2 -> IO16
+#endif
+#ifndef CONFIG_HX711_DAT3_GPIO
+#define CONFIG_HX711_DAT3_GPIO  17  // DOUT of device 3 -> IO17
+#endif
+
+// SPI backend: SCLK drives PD_SCK, MISO samples DOUT (RTD owns SPI2_HOST)
+#ifndef CONFIG_HX711_SPI_HOST
+#define CONFIG_HX711_SPI_HOST  SPI3_HOST
+#endif
+#ifndef CONFIG_HX711_SPI_FREQ_HZ
+#define CONFIG_HX711_SPI_FREQ_HZ  1000000   // 0.5 us PD_SCK high (datasheet min 0.2 us)
+#endif
+
 #endif 
@@ -0,0 +1,51 @@
+#ifndef HX711_PORT_H_
+#define HX711_PORT_H_
+
+/*
+  Readout backend used by hx711.c. Exactly one implementation is compiled,
+  selected by _HX711_BACKEND in hx711Config.h:
+    hx711_gpio.c   bit-banged PD_SCK
+    hx711_spi.c    PD_SCK/DOUT shifted by an SPI host
+    hx711_mock.c   host-side scripted conversions
+    hx711_replay.c host-side playback of recorded CSV logs
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "hx711.h"
+#include "hx711Config.h"
+
+//####################################################################################################################
+
+void        hx711_port_init(hx711_t *hx711);
+void        hx711_port_clk(hx711_t *hx711, uint8_t level);        // drive PD_SCK (1 >60 us = power down)
+uint8_t     hx711_port_ready(hx711_t *hx711);                     // DOUT low: conversion available
+uint32_t    hx711_port_shift(hx711_t *hx711, uint8_t pulses);     // clock out 24 data bits + trailing pulses
+int64_t     hx711_port_time_us(hx711_t *hx711);                   // clock used to timestamp conversions
+
+#if _HX711_BACKEND == HX711_BACKEND_MOCK
+// Mock backend: queue raw two's-complement conversions for the next reads
+void        hx711_mock_push(hx711_t *hx711, int32_t raw);
+void        hx711_mock_reset(hx711_t *hx711);
+uint8_t     hx711_mock_pulses(hx711_t *hx711);                    // PD_SCK pulses of the last readout (0: none)
+#endif
+
+#if _HX711_BACKEND == HX711_BACKEND_REPLAY
+// Replay backend: play a "timestamp_iso,raw_value,..." log (python/*.csv).
+// speed 1.0 = recorded pace, N = N times faster, 0 = as fast as read.
+// Open after hx711_init(); samples carry the recorded timestamps.
+int         hx711_replay_open(hx711_t *hx711, const char *csv_path, float speed);
+void        hx711_replay_close(hx711_t *hx711);
+uint8_t     hx711_replay_done(hx711_t *hx711);
+#endif
+
+//####################################################################################################################
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
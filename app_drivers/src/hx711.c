@@ -1,88 +1,340 @@
 #include "hx711.h"
 #include "hx711Config.h"
+#include "hx711_port.h"
+#include <math.h>
+
+#ifdef ESP_PLATFORM
 #include "driver/gpio.h"
 #include "esp_timer.h"
-
+#include "esp_attr.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #define hx711_delay(x)    vTaskDelay(pdMS_TO_TICKS(x))
+#define hx711_time_us()   esp_timer_get_time()
+#else
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#define hx711_delay(x)    usleep((x) * 1000)
+static int64_t hx711_time_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
 
 //#############################################################################################
-static inline void hx711_delay_us_inline(uint32_t us)
+#ifdef ESP_PLATFORM
+void hx711_lock(hx711_t *hx711)
+{
+  xSemaphoreTake(hx711->mutex, portMAX_DELAY);
+}
+//#############################################################################################
+void hx711_unlock(hx711_t *hx711)
 {
-  uint64_t start = esp_timer_get_time();
-  while ((esp_timer_get_time() - start) < us) { }
+  xSemaphoreGive(hx711->mutex);
 }
+#else
 //#############################################################################################
 void hx711_lock(hx711_t *hx711)
 {
   while (hx711->lock)
     hx711_delay(1);
-  hx711->lock = 1;      
+  hx711->lock = 1;
 }
 //#############################################################################################
 void hx711_unlock(hx711_t *hx711)
 {
   hx711->lock = 0;
 }
+#endif
 //#############################################################################################
 void hx711_init(hx711_t *hx711, gpio_num_t clk_gpio, gpio_num_t dat_gpio)
 {
+#ifdef ESP_PLATFORM
+  if (hx711->mutex == NULL)
+    hx711->mutex = xSemaphoreCreateMutexStatic(&hx711->mutex_buf);
+#endif
   hx711_lock(hx711);
   hx711->clk_gpio = clk_gpio;
   hx711->dat_gpio = dat_gpio;
-  
-  gpio_config_t clk_conf = {
-    .pin_bit_mask = (1ULL << clk_gpio),
-    .mode = GPIO_MODE_OUTPUT,
-    .pull_up_en = GPIO_PULLUP_DISABLE,
-    .pull_down_en = GPIO_PULLDOWN_DISABLE,
-    .intr_type = GPIO_INTR_DISABLE
-  };
-  gpio_config(&clk_conf);
-  gpio_config_t dat_conf = {
-    .pin_bit_mask = (1ULL << dat_gpio),
-    .mode = GPIO_MODE_INPUT,
-    .pull_up_en = GPIO_PULLUP_ENABLE,
-    .pull_down_en = GPIO_PULLDOWN_DISABLE,
-    .intr_type = GPIO_INTR_DISABLE
-  };
-  gpio_config(&dat_conf);
-  gpio_set_level(hx711->clk_gpio, 1);
+  hx711->drdy_task = NULL;
+  hx711->seq = 0;
+  hx711->req = HX711_REQ_NONE;
+  hx711_stats_reset(hx711);
+  hx711->gain = HX711_GAIN_A_128;
+  hx711->gain_next = HX711_GAIN_A_128;
+  hx711->settle = 0;
+
+  hx711_port_init(hx711);
+  hx711_port_clk(hx711, 1);
+  hx711_delay(10);
+  hx711_port_clk(hx711, 0);
   hx711_delay(10);
-  gpio_set_level(hx711->clk_gpio, 0);
-  hx711_delay(10);  
   hx711_value(hx711);
   hx711_value(hx711);
-  hx711_unlock(hx711); 
+  hx711_unlock(hx711);
+}
+//#############################################################################################
+static int32_t hx711_shift_in(hx711_t *hx711, hx711_sample_t *sample)
+{
+  // Trailing pulses select channel/gain for the conversion after this one
+  uint32_t data = hx711_port_shift(hx711, (uint8_t)hx711->gain_next);
+  data = data ^ 0x800000;
+  if (sample != NULL)
+  {
+    sample->value = data;
+    sample->gain = hx711->gain;
+    sample->settling = hx711->settle > 0;
+  }
+  if (hx711->settle > 0)
+    hx711->settle--;
+  if (hx711->gain_next != hx711->gain)
+  {
+    hx711->gain = hx711->gain_next;
+    hx711->settle = _HX711_SETTLE_CONVERSIONS;
+  }
+  return data;
+}
+//#############################################################################################
+void hx711_set_gain(hx711_t *hx711, hx711_gain_t gain)
+{
+  hx711->gain_next = gain;
+}
+//#############################################################################################
+hx711_gain_t hx711_get_gain(hx711_t *hx711)
+{
+  return hx711->gain_next;
+}
+//#############################################################################################
+uint8_t hx711_settling(hx711_t *hx711)
+{
+  return hx711->settle;
 }
 //#############################################################################################
 int32_t hx711_value(hx711_t *hx711)
 {
-  uint32_t data = 0;
-  uint64_t  startTime = esp_timer_get_time();
-  while(gpio_get_level(hx711->dat_gpio) == 1)
+  int64_t  startTime = hx711_time_us();
+  while(!hx711_port_ready(hx711))
   {
     hx711_delay(1);
-    if((esp_timer_get_time() - startTime) > 150000)
+    if((hx711_time_us() - startTime) > 150000)
       return 0;
   }
-  for(int8_t i=0; i<24 ; i++)
+  return hx711_shift_in(hx711, NULL);
+}
+//#############################################################################################
+#ifdef ESP_PLATFORM
+static void IRAM_ATTR hx711_drdy_isr(void *arg)
+{
+  hx711_t *hx711 = (hx711_t *)arg;
+  BaseType_t woken = pdFALSE;
+  // DOUT toggles while clocking; stay masked until the reader re-arms
+  gpio_intr_disable(hx711->dat_gpio);
+  hx711->drdy_time_us = esp_timer_get_time();
+  vTaskNotifyGiveFromISR(hx711->drdy_task, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+//#############################################################################################
+esp_err_t hx711_drdy_start(hx711_t *hx711)
+{
+  // Conversions are delivered to the task that arms the interrupt
+  hx711->drdy_task = xTaskGetCurrentTaskHandle();
+  esp_err_t err = gpio_install_isr_service(0);
+  if (err != ESP_OK && err != ESP_ERR_INVALID_STATE)
   {
-    gpio_set_level(hx711->clk_gpio, 1);   
-    hx711_delay_us_inline(_HX711_DELAY_US_LOOP);
-    gpio_set_level(hx711->clk_gpio, 0);
-    hx711_delay_us_inline(_HX711_DELAY_US_LOOP);
-    data = data << 1;    
-    if(gpio_get_level(hx711->dat_gpio) == 1)
-      data ++;
+    hx711->drdy_task = NULL;
+    return err;
   }
-  data = data ^ 0x800000; 
-  gpio_set_level(hx711->clk_gpio, 1);   
-  hx711_delay_us_inline(_HX711_DELAY_US_LOOP);
-  gpio_set_level(hx711->clk_gpio, 0);
-  hx711_delay_us_inline(_HX711_DELAY_US_LOOP);
-  return data;    
+  gpio_set_intr_type(hx711->dat_gpio, GPIO_INTR_NEGEDGE);
+  err = gpio_isr_handler_add(hx711->dat_gpio, hx711_drdy_isr, hx711);
+  if (err != ESP_OK)
+  {
+    hx711->drdy_task = NULL;
+    return err;
+  }
+  gpio_intr_enable(hx711->dat_gpio);
+  return ESP_OK;
+}
+//#############################################################################################
+void hx711_drdy_stop(hx711_t *hx711)
+{
+  if (hx711->drdy_task == NULL)
+    return;
+  gpio_intr_disable(hx711->dat_gpio);
+  gpio_isr_handler_remove(hx711->dat_gpio);
+  gpio_set_intr_type(hx711->dat_gpio, GPIO_INTR_DISABLE);
+  hx711->drdy_task = NULL;
+}
+#else
+//#############################################################################################
+esp_err_t hx711_drdy_start(hx711_t *hx711)
+{
+  (void)hx711;
+  return ESP_ERR_NOT_SUPPORTED;
+}
+//#############################################################################################
+void hx711_drdy_stop(hx711_t *hx711)
+{
+  hx711->drdy_task = NULL;
+}
+#endif
+//#############################################################################################
+void hx711_stat_reset(hx711_stat_t *stat)
+{
+  stat->count = 0;
+  stat->min_us = INT64_MAX;
+  stat->max_us = 0;
+  stat->mean_us = 0.0;
+  stat->m2 = 0.0;
+}
+//#############################################################################################
+void hx711_stat_add(hx711_stat_t *stat, int64_t us)
+{
+  if (us < stat->min_us)
+    stat->min_us = us;
+  if (us > stat->max_us)
+    stat->max_us = us;
+  stat->count++;
+  double delta = (double)us - stat->mean_us;
+  stat->mean_us += delta / stat->count;
+  stat->m2 += delta * ((double)us - stat->mean_us);
+}
+//#############################################################################################
+double hx711_stat_stddev(const hx711_stat_t *stat)
+{
+  return (stat->count > 1) ? sqrt(stat->m2 / (stat->count - 1)) : 0.0;
+}
+//#############################################################################################
+void hx711_stats_reset(hx711_t *hx711)
+{
+  hx711_stat_reset(&hx711->interval);
+  hx711_stat_reset(&hx711->latency);
+  hx711->last_time_us = INT64_MIN;
+}
+//#############################################################################################
+static void hx711_stats_update(hx711_t *hx711, int64_t drdy_us, int64_t read_us)
+{
+  if (hx711->last_time_us != INT64_MIN)
+    hx711_stat_add(&hx711->interval, drdy_us - hx711->last_time_us);
+  hx711->last_time_us = drdy_us;
+  hx711_stat_add(&hx711->latency, read_us - drdy_us);
+}
+//#############################################################################################
+static void hx711_request_feed(hx711_t *hx711, const hx711_sample_t *sample)
+{
+  hx711_req_t req = HX711_REQ_NONE;
+  hx711_done_cb_t cb = NULL;
+  void *arg = NULL;
+  int32_t average = 0;
+  float weight = 0.0f;
+
+  hx711_lock(hx711);
+  if (hx711->req != HX711_REQ_NONE && sample->gain == hx711->req_gain && !sample->settling)
+  {
+    hx711->req_sum += sample->value;
+    if (++hx711->req_count >= hx711->req_samples)
+    {
+      req = hx711->req;
+      cb = hx711->req_cb;
+      arg = hx711->req_arg;
+      average = (int32_t)(hx711->req_sum / hx711->req_count);
+      if (req == HX711_REQ_TARE)
+        hx711->offset = average;
+      weight = (average - hx711->offset) / hx711->coef;
+      hx711->req = HX711_REQ_NONE;
+    }
+  }
+  hx711_unlock(hx711);
+
+  // Outside the lock so the callback may queue a follow-up request
+  if (req != HX711_REQ_NONE && cb != NULL)
+    cb(hx711, req, average, weight, arg);
+}
+//#############################################################################################
+uint8_t hx711_request(hx711_t *hx711, hx711_gain_t gain, hx711_req_t req, uint16_t sample, hx711_done_cb_t cb, void *arg)
+{
+  if (req == HX711_REQ_NONE || sample == 0)
+    return 0;
+  uint8_t ok = 0;
+  hx711_lock(hx711);
+  if (hx711->req == HX711_REQ_NONE)
+  {
+    hx711->req_gain = gain;
+    hx711->req_samples = sample;
+    hx711->req_count = 0;
+    hx711->req_sum = 0;
+    hx711->req_cb = cb;
+    hx711->req_arg = arg;
+    hx711->req = req;
+    ok = 1;
+  }
+  hx711_unlock(hx711);
+  return ok;
+}
+//#############################################################################################
+uint8_t hx711_request_pending(hx711_t *hx711)
+{
+  return hx711->req != HX711_REQ_NONE;
+}
+//#############################################################################################
+uint8_t hx711_read_sample(hx711_t *hx711, hx711_sample_t *sample, uint32_t timeout_ms)
+{
+  uint8_t ok = 0;
+  if (hx711->drdy_task == NULL)
+  {
+    // Polled mode: wait unlocked, timestamp when DOUT is seen low
+    int64_t now = hx711_time_us();
+    while (!hx711_port_ready(hx711))
+    {
+      hx711_delay(1);
+      if ((hx711_time_us() - now) > (int64_t)timeout_ms * 1000)
+        return 0;
+    }
+    // Timestamps come from the backend clock (recorded time when replaying)
+    now = hx711_port_time_us(hx711);
+    hx711_lock(hx711);
+    if (hx711_port_ready(hx711))
+    {
+      hx711_stats_update(hx711, now, hx711_port_time_us(hx711));
+      hx711_shift_in(hx711, sample);
+      sample->timestamp_us = now;
+      sample->seq = ++hx711->seq;
+      ok = 1;
+    }
+    hx711_unlock(hx711);
+    if (ok)
+      hx711_request_feed(hx711, sample);
+    return ok;
+  }
+#ifdef ESP_PLATFORM
+  if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms)) == 0)
+  {
+    // Edge missed (e.g. conversion already pending when armed): recover by level
+    if (!hx711_port_ready(hx711))
+      return 0;
+    gpio_intr_disable(hx711->dat_gpio);
+    hx711->drdy_time_us = esp_timer_get_time();
+  }
+  hx711_lock(hx711);
+  // A blocking reader (tare/average) may have consumed this conversion already
+  if (hx711_port_ready(hx711))
+  {
+    hx711_stats_update(hx711, hx711->drdy_time_us, esp_timer_get_time());
+    hx711_shift_in(hx711, sample);
+    sample->timestamp_us = hx711->drdy_time_us;
+    sample->seq = ++hx711->seq;
+    ok = 1;
+  }
+  hx711_unlock(hx711);
+  gpio_intr_enable(hx711->dat_gpio);
+  if (ok)
+    hx711_request_feed(hx711, sample);
+  return ok;
+#else
+  return ok;
+#endif
 }
 //#############################################################################################
 int32_t hx711_value_ave(hx711_t *hx711, uint16_t sample)
@@ -116,7 +368,7 @@ void hx711_calibration(hx711_t *hx711, int32_t noload_raw, int32_t load_raw, flo
 {
   hx711_lock(hx711);
   hx711->offset = noload_raw;
-  hx711->coef = (load_raw - noload_raw) / scale;  
+  hx711->coef = (load_raw - noload_raw) / scale;
   hx711_unlock(hx711);
 }
 //#############################################################################################
@@ -137,23 +389,23 @@ float hx711_weight(hx711_t *hx711, uint16_t sample)
 //#############################################################################################
 void hx711_coef_set(hx711_t *hx711, float coef)
 {
-  hx711->coef = coef;  
+  hx711->coef = coef;
 }
 //#############################################################################################
 float hx711_coef_get(hx711_t *hx711)
 {
-  return hx711->coef;  
+  return hx711->coef;
 }
 //#############################################################################################
 void hx711_power_down(hx711_t *hx711)
 {
-  gpio_set_level(hx711->clk_gpio, 0);
-  gpio_set_level(hx711->clk_gpio, 1);
-  hx711_delay(1);  
+  hx711_port_clk(hx711, 0);
+  hx711_port_clk(hx711, 1);
+  hx711_delay(1);
 }
 //#############################################################################################
 void hx711_power_up(hx711_t *hx711)
 {
-  gpio_set_level(hx711->clk_gpio, 0);
+  hx711_port_clk(hx711, 0);
 }
 //#############################################################################################
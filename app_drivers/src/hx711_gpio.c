@@ -0,0 +1,72 @@
+#include "hx711Config.h"
+#if _HX711_BACKEND == HX711_BACKEND_GPIO
+#include "hx711_port.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+
+//#############################################################################################
+static inline void hx711_delay_us_inline(uint32_t us)
+{
+  uint64_t start = esp_timer_get_time();
+  while ((esp_timer_get_time() - start) < us) { }
+}
+//#############################################################################################
+void hx711_port_init(hx711_t *hx711)
+{
+  gpio_config_t clk_conf = {
+    .pin_bit_mask = (1ULL << hx711->clk_gpio),
+    .mode = GPIO_MODE_OUTPUT,
+    .pull_up_en = GPIO_PULLUP_DISABLE,
+    .pull_down_en = GPIO_PULLDOWN_DISABLE,
+    .intr_type = GPIO_INTR_DISABLE
+  };
+  gpio_config(&clk_conf);
+  gpio_config_t dat_conf = {
+    .pin_bit_mask = (1ULL << hx711->dat_gpio),
+    .mode = GPIO_MODE_INPUT,
+    .pull_up_en = GPIO_PULLUP_ENABLE,
+    .pull_down_en = GPIO_PULLDOWN_DISABLE,
+    .intr_type = GPIO_INTR_DISABLE
+  };
+  gpio_config(&dat_conf);
+}
+//#############################################################################################
+void hx711_port_clk(hx711_t *hx711, uint8_t level)
+{
+  gpio_set_level(hx711->clk_gpio, level);
+}
+//#############################################################################################
+uint8_t hx711_port_ready(hx711_t *hx711)
+{
+  return gpio_get_level(hx711->dat_gpio) == 0;
+}
+//#############################################################################################
+uint32_t hx711_port_shift(hx711_t *hx711, uint8_t pulses)
+{
+  uint32_t data = 0;
+  for(int8_t i=0; i<24 ; i++)
+  {
+    gpio_set_level(hx711->clk_gpio, 1);
+    hx711_delay_us_inline(_HX711_DELAY_US_LOOP);
+    gpio_set_level(hx711->clk_gpio, 0);
+    hx711_delay_us_inline(_HX711_DELAY_US_LOOP);
+    data = data << 1;
+    if(gpio_get_level(hx711->dat_gpio) == 1)
+      data ++;
+  }
+  for(uint8_t i=24; i<pulses ; i++)
+  {
+    gpio_set_level(hx711->clk_gpio, 1);
+    hx711_delay_us_inline(_HX711_DELAY_US_LOOP);
+    gpio_set_level(hx711->clk_gpio, 0);
+    hx711_delay_us_inline(_HX711_DELAY_US_LOOP);
+  }
+  return data;
+}
+//#############################################################################################
+int64_t hx711_port_time_us(hx711_t *hx711)
+{
+  return esp_timer_get_time();
+}
+//#############################################################################################
+#endif
@@ -0,0 +1,91 @@
+#include "hx711Config.h"
+#if _HX711_BACKEND == HX711_BACKEND_MOCK
+#include "hx711_port.h"
+#include <stdlib.h>
+#include <time.h>
+
+/*
+  Host-side stand-in for the HX711: conversions queued with hx711_mock_push()
+  are returned by subsequent reads in order; an empty queue reads as "busy".
+  The PD_SCK pulse count of the last readout is kept for hx711_mock_pulses().
+*/
+
+#define HX711_MOCK_DEPTH   256
+
+typedef struct
+{
+  int32_t   raw[HX711_MOCK_DEPTH];
+  uint16_t  head;
+  uint16_t  count;
+  uint8_t   clk;
+  uint8_t   pulses;
+
+}hx711_mock_t;
+
+//#############################################################################################
+void hx711_port_init(hx711_t *hx711)
+{
+  if (hx711->port == NULL)
+    hx711->port = calloc(1, sizeof(hx711_mock_t));
+}
+//#############################################################################################
+void hx711_port_clk(hx711_t *hx711, uint8_t level)
+{
+  ((hx711_mock_t *)hx711->port)->clk = level;
+}
+//#############################################################################################
+uint8_t hx711_port_ready(hx711_t *hx711)
+{
+  hx711_mock_t *mock = (hx711_mock_t *)hx711->port;
+  return mock->clk == 0 && mock->count > 0;
+}
+//#############################################################################################
+uint32_t hx711_port_shift(hx711_t *hx711, uint8_t pulses)
+{
+  hx711_mock_t *mock = (hx711_mock_t *)hx711->port;
+  mock->pulses = pulses;
+  if (mock->count == 0)
+    return 0xFFFFFF;
+  int32_t raw = mock->raw[mock->head];
+  mock->head = (mock->head + 1) % HX711_MOCK_DEPTH;
+  mock->count--;
+  // Wire format: 24-bit two's complement, as shifted out on DOUT
+  return ((uint32_t)raw) & 0xFFFFFF;
+}
+//#############################################################################################
+void hx711_mock_push(hx711_t *hx711, int32_t raw)
+{
+  hx711_port_init(hx711);
+  hx711_mock_t *mock = (hx711_mock_t *)hx711->port;
+  if (mock->count == HX711_MOCK_DEPTH)
+    return;
+  mock->raw[(mock->head + mock->count) % HX711_MOCK_DEPTH] = raw;
+  mock->count++;
+}
+//#############################################################################################
+void hx711_mock_reset(hx711_t *hx711)
+{
+  hx711_mock_t *mock = (hx711_mock_t *)hx711->port;
+  if (mock != NULL)
+  {
+    mock->head = 0;
+    mock->count = 0;
+    mock->pulses = 0;
+  }
+}
+//#############################################################################################
+uint8_t hx711_mock_pulses(hx711_t *hx711)
+{
+  hx711_mock_t *mock = (hx711_mock_t *)hx711->port;
+  return mock != NULL ? mock->pulses : 0;
+}
+//#############################################################################################
+int64_t hx711_port_time_us(hx711_t *hx711)
+{
+  (void)hx711;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+//#############################################################################################
+#endif
@@ -0,0 +1,135 @@
+#include "hx711.h"
+#include "hx711Config.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "soc/soc.h"
+#include "soc/gpio_reg.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/*
+  N HX711s share PD_SCK; each has its own DOUT. On every clock the GPIO
+  input register is read once, capturing one bit of every device. Decoding
+  into per-device words happens after the last pulse so the clocked loop
+  stays as short as the single-device one.
+*/
+
+//#############################################################################################
+static inline void hx711_multi_delay_us(uint32_t us)
+{
+  uint64_t start = esp_timer_get_time();
+  while ((esp_timer_get_time() - start) < us) { }
+}
+//#############################################################################################
+static inline uint8_t hx711_multi_all_ready(hx711_multi_t *multi)
+{
+  if (REG_READ(GPIO_IN_REG) & multi->mask_lo)
+    return 0;
+  if (multi->mask_hi && (REG_READ(GPIO_IN1_REG) & multi->mask_hi))
+    return 0;
+  return 1;
+}
+//#############################################################################################
+void hx711_multi_init(hx711_multi_t *multi, gpio_num_t clk_gpio, const gpio_num_t *dat_gpio, uint8_t count)
+{
+  if (count > HX711_MULTI_MAX)
+    count = HX711_MULTI_MAX;
+  multi->clk_gpio = clk_gpio;
+  multi->count = count;
+  multi->mask_lo = 0;
+  multi->mask_hi = 0;
+  multi->gain = HX711_GAIN_A_128;
+  multi->seq = 0;
+  hx711_multi_stats_reset(multi);
+
+  uint64_t dat_mask = 0;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    multi->dat_gpio[i] = dat_gpio[i];
+    dat_mask |= (1ULL << dat_gpio[i]);
+    if (dat_gpio[i] < 32)
+      multi->mask_lo |= (1UL << dat_gpio[i]);
+    else
+      multi->mask_hi |= (1UL << (dat_gpio[i] - 32));
+  }
+
+  gpio_config_t clk_conf = {
+    .pin_bit_mask = (1ULL << clk_gpio),
+    .mode = GPIO_MODE_OUTPUT,
+    .pull_up_en = GPIO_PULLUP_DISABLE,
+    .pull_down_en = GPIO_PULLDOWN_DISABLE,
+    .intr_type = GPIO_INTR_DISABLE
+  };
+  gpio_config(&clk_conf);
+  gpio_config_t dat_conf = {
+    .pin_bit_mask = dat_mask,
+    .mode = GPIO_MODE_INPUT,
+    .pull_up_en = GPIO_PULLUP_ENABLE,
+    .pull_down_en = GPIO_PULLDOWN_DISABLE,
+    .intr_type = GPIO_INTR_DISABLE
+  };
+  gpio_config(&dat_conf);
+  gpio_set_level(clk_gpio, 1);
+  vTaskDelay(pdMS_TO_TICKS(10));
+  gpio_set_level(clk_gpio, 0);
+  vTaskDelay(pdMS_TO_TICKS(10));
+}
+//#############################################################################################
+uint8_t hx711_multi_read(hx711_multi_t *multi, hx711_multi_sample_t *sample, uint32_t timeout_ms)
+{
+  int64_t start = esp_timer_get_time();
+  while (!hx711_multi_all_ready(multi))
+  {
+    vTaskDelay(1);
+    if ((esp_timer_get_time() - start) > (int64_t)timeout_ms * 1000)
+      return 0;
+  }
+  // Polled: data ready is seen at tick resolution, when every DOUT is first found low
+  sample->timestamp_us = esp_timer_get_time();
+  if (multi->last_time_us != INT64_MIN)
+    hx711_stat_add(&multi->interval, sample->timestamp_us - multi->last_time_us);
+  multi->last_time_us = sample->timestamp_us;
+
+  uint32_t in_lo[24];
+  uint32_t in_hi[24];
+  for (int8_t i = 0; i < 24; i++)
+  {
+    gpio_set_level(multi->clk_gpio, 1);
+    hx711_multi_delay_us(_HX711_DELAY_US_LOOP);
+    gpio_set_level(multi->clk_gpio, 0);
+    hx711_multi_delay_us(_HX711_DELAY_US_LOOP);
+    in_lo[i] = REG_READ(GPIO_IN_REG);
+    in_hi[i] = multi->mask_hi ? REG_READ(GPIO_IN1_REG) : 0;
+  }
+  for (uint8_t i = 24; i < (uint8_t)multi->gain; i++)
+  {
+    gpio_set_level(multi->clk_gpio, 1);
+    hx711_multi_delay_us(_HX711_DELAY_US_LOOP);
+    gpio_set_level(multi->clk_gpio, 0);
+    hx711_multi_delay_us(_HX711_DELAY_US_LOOP);
+  }
+  // Latency: data ready to the end of the shift, trailing gain pulses included
+  hx711_stat_add(&multi->latency, esp_timer_get_time() - sample->timestamp_us);
+
+  for (uint8_t d = 0; d < multi->count; d++)
+  {
+    gpio_num_t pin = multi->dat_gpio[d];
+    uint32_t data = 0;
+    for (int8_t i = 0; i < 24; i++)
+    {
+      uint32_t bit = (pin < 32) ? (in_lo[i] >> pin) : (in_hi[i] >> (pin - 32));
+      data = (data << 1) | (bit & 1U);
+    }
+    sample->value[d] = data ^ 0x800000;
+  }
+  sample->seq = ++multi->seq;
+  return 1;
+}
+//#############################################################################################
+void hx711_multi_stats_reset(hx711_multi_t *multi)
+{
+  hx711_stat_reset(&multi->interval);
+  hx711_stat_reset(&multi->latency);
+  multi->last_time_us = INT64_MIN;
+}
+//#############################################################################################
@@ -0,0 +1,142 @@
+#include "hx711Config.h"
+#if _HX711_BACKEND == HX711_BACKEND_REPLAY
+#include "hx711_port.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+  Host-side HX711 that plays back logs captured by python/loadcell_log.py
+  ("timestamp_iso,raw_value[,...]"). raw_value is the driver's output
+  (offset binary), so it is re-encoded to the DOUT wire format here and
+  hx711.c decodes it back unchanged. A conversion becomes "ready" once
+  the scaled wall-clock time reaches its recorded offset from the first
+  row; with speed 0 every row is ready immediately.
+*/
+
+typedef struct
+{
+  FILE      *file;
+  float     speed;
+  int64_t   t0_us;          // recorded time of the first row
+  int64_t   wall0_us;       // host time when playback started
+  int64_t   next_us;        // recorded time of the pending row
+  int32_t   next_raw;
+  uint8_t   has_next;
+  uint8_t   clk;
+
+}hx711_replay_t;
+
+//#############################################################################################
+static int64_t hx711_replay_wall_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+//#############################################################################################
+static int64_t hx711_replay_days(int y, int m, int d)
+{
+  // Days since 1970-01-01 (proleptic Gregorian)
+  y -= m <= 2;
+  int64_t era = (y >= 0 ? y : y - 399) / 400;
+  int64_t yoe = y - era * 400;
+  int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + doe - 719468;
+}
+//#############################################################################################
+static void hx711_replay_next(hx711_replay_t *r)
+{
+  char line[128];
+  r->has_next = 0;
+  while (fgets(line, sizeof(line), r->file) != NULL)
+  {
+    int y, mo, d, h, mi;
+    double sec;
+    long raw;
+    if (sscanf(line, "%d-%d-%dT%d:%d:%lf,%ld", &y, &mo, &d, &h, &mi, &sec, &raw) != 7)
+      continue;     // header or malformed row
+    int64_t s = ((hx711_replay_days(y, mo, d) * 24 + h) * 60 + mi) * 60;
+    r->next_us = s * 1000000 + (int64_t)(sec * 1e6 + 0.5);
+    r->next_raw = (int32_t)raw;
+    r->has_next = 1;
+    return;
+  }
+}
+//#############################################################################################
+void hx711_port_init(hx711_t *hx711)
+{
+  if (hx711->port == NULL)
+    hx711->port = calloc(1, sizeof(hx711_replay_t));
+}
+//#############################################################################################
+void hx711_port_clk(hx711_t *hx711, uint8_t level)
+{
+  ((hx711_replay_t *)hx711->port)->clk = level;
+}
+//#############################################################################################
+uint8_t hx711_port_ready(hx711_t *hx711)
+{
+  hx711_replay_t *r = (hx711_replay_t *)hx711->port;
+  if (r->clk || !r->has_next)
+    return 0;
+  if (r->speed <= 0.0f)
+    return 1;
+  return (double)(hx711_replay_wall_us() - r->wall0_us) * r->speed >= (double)(r->next_us - r->t0_us);
+}
+//#############################################################################################
+uint32_t hx711_port_shift(hx711_t *hx711, uint8_t pulses)
+{
+  (void)pulses;
+  hx711_replay_t *r = (hx711_replay_t *)hx711->port;
+  if (!r->has_next)
+    return 0xFFFFFF;
+  uint32_t data = ((uint32_t)r->next_raw ^ 0x800000) & 0xFFFFFF;
+  hx711_replay_next(r);
+  return data;
+}
+//#############################################################################################
+int64_t hx711_port_time_us(hx711_t *hx711)
+{
+  // Virtual clock: the recorded time of the conversion about to be read
+  hx711_replay_t *r = (hx711_replay_t *)hx711->port;
+  return r->has_next ? r->next_us - r->t0_us : 0;
+}
+//#############################################################################################
+int hx711_replay_open(hx711_t *hx711, const char *csv_path, float speed)
+{
+  hx711_port_init(hx711);
+  hx711_replay_t *r = (hx711_replay_t *)hx711->port;
+  hx711_replay_close(hx711);
+  r->file = fopen(csv_path, "r");
+  if (r->file == NULL)
+    return -1;
+  r->speed = speed;
+  hx711_replay_next(r);
+  r->t0_us = r->next_us;
+  r->wall0_us = hx711_replay_wall_us();
+  // Every conversion gets an interval again, from the recorded timeline
+  hx711_stats_reset(hx711);
+  return r->has_next ? 0 : -1;
+}
+//#############################################################################################
+void hx711_replay_close(hx711_t *hx711)
+{
+  hx711_replay_t *r = (hx711_replay_t *)hx711->port;
+  if (r != NULL && r->file != NULL)
+  {
+    fclose(r->file);
+    r->file = NULL;
+  }
+  if (r != NULL)
+    r->has_next = 0;
+}
+//#############################################################################################
+uint8_t hx711_replay_done(hx711_t *hx711)
+{
+  hx711_replay_t *r = (hx711_replay_t *)hx711->port;
+  return r == NULL || !r->has_next;
+}
+//#############################################################################################
+#endif
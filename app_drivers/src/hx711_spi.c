@@ -0,0 +1,94 @@
+#include "hx711Config.h"
+#if _HX711_BACKEND == HX711_BACKEND_SPI
+#include "hx711_port.h"
+#include "driver/gpio.h"
+#include "driver/spi_master.h"
+#include "esp_rom_gpio.h"
+#include "soc/spi_periph.h"
+#include "soc/gpio_sig_map.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/*
+  SCLK is wired to PD_SCK and MISO to DOUT; MOSI and CS are unused.
+  SPI mode 1 idles SCLK low and samples on the falling edge, after the
+  HX711 has shifted the next bit out on the rising edge. A whole readout
+  is one hardware transaction, so preemption cannot stretch PD_SCK high
+  into the 60 us power-down window.
+*/
+
+static const char *TAG = "hx711_spi";
+
+//#############################################################################################
+void hx711_port_init(hx711_t *hx711)
+{
+  spi_bus_config_t buscfg = {
+    .miso_io_num = hx711->dat_gpio,
+    .mosi_io_num = -1,
+    .sclk_io_num = hx711->clk_gpio,
+    .quadwp_io_num = -1,
+    .quadhd_io_num = -1,
+    .max_transfer_sz = 4,
+    .flags = SPICOMMON_BUSFLAG_MASTER | SPICOMMON_BUSFLAG_MISO | SPICOMMON_BUSFLAG_SCLK
+  };
+  ESP_ERROR_CHECK(spi_bus_initialize(CONFIG_HX711_SPI_HOST, &buscfg, SPI_DMA_DISABLED));
+
+  spi_device_interface_config_t devcfg = {
+    .clock_speed_hz = CONFIG_HX711_SPI_FREQ_HZ,
+    .mode = 1,
+    .spics_io_num = -1,
+    .queue_size = 1,
+    .flags = SPI_DEVICE_HALFDUPLEX,
+  };
+  spi_device_handle_t dev = NULL;
+  ESP_ERROR_CHECK(spi_bus_add_device(CONFIG_HX711_SPI_HOST, &devcfg, &dev));
+  hx711->port = dev;
+
+  // Keep the DOUT pull-up of the GPIO backend so an absent HX711 reads "not ready"
+  gpio_set_pull_mode(hx711->dat_gpio, GPIO_PULLUP_ONLY);
+}
+//#############################################################################################
+void hx711_port_clk(hx711_t *hx711, uint8_t level)
+{
+  if (level)
+  {
+    // Take PD_SCK away from the SPI host and hold it high
+    gpio_set_level(hx711->clk_gpio, 1);
+    esp_rom_gpio_connect_out_signal(hx711->clk_gpio, SIG_GPIO_OUT_IDX, false, false);
+  }
+  else
+  {
+    // Back to the SPI host, which idles SCLK low in mode 1
+    gpio_set_level(hx711->clk_gpio, 0);
+    esp_rom_gpio_connect_out_signal(hx711->clk_gpio,
+                                    spi_periph_signal[CONFIG_HX711_SPI_HOST].spiclk_out, false, false);
+  }
+}
+//#############################################################################################
+uint8_t hx711_port_ready(hx711_t *hx711)
+{
+  return gpio_get_level(hx711->dat_gpio) == 0;
+}
+//#############################################################################################
+uint32_t hx711_port_shift(hx711_t *hx711, uint8_t pulses)
+{
+  spi_transaction_t t = {
+    .flags = SPI_TRANS_USE_RXDATA,
+    .length = 0,
+    .rxlength = pulses,
+  };
+  if (spi_device_polling_transmit((spi_device_handle_t)hx711->port, &t) != ESP_OK)
+  {
+    ESP_LOGE(TAG, "readout failed");
+    return 0x800000;
+  }
+  // First 24 clocks carry the conversion MSB first; trailing pulses select the next gain
+  return ((uint32_t)t.rx_data[0] << 16) | ((uint32_t)t.rx_data[1] << 8) | t.rx_data[2];
+}
+//#############################################################################################
+int64_t hx711_port_time_us(hx711_t *hx711)
+{
+  return esp_timer_get_time();
+}
+//#############################################################################################
+#endif
@@ -0,0 +1,36 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+
+/*
+  Assertions shared by the host tests: a failed CHECK is reported with its
+  location and counted, and the test carries on. main() ends with
+  return check_done("<test>");
+*/
+
+static int check_failures;
+
+#define CHECK(cond)                                                           \
+    do {                                                                      \
+        if (!(cond)) {                                                        \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);   \
+            check_failures++;                                                 \
+        }                                                                     \
+    } while (0)
+
+/**
+  * @brief  Summary line and exit status of a test program
+  * @retval 0 if every check passed, 1 otherwise
+  */
+static inline int check_done(const char *name)
+{
+    if (check_failures) {
+        printf("%s: %d check(s) failed\n", name, check_failures);
+        return 1;
+    }
+    printf("%s: all checks passed\n", name);
+    return 0;
+}
+
+#endif /* CHECK_H */
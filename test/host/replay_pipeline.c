@@ -0,0 +1,309 @@
+#include "hx711.h"
+#include "hx711_port.h"
+#include "filter_chain.h"
+#include "cycle_analyzer.h"
+#include "cure_run.h"
+#include "check.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+  Host run of the MDR torque pipeline on a recorded load cell log:
+    replay backend -> hx711 driver -> raw filter chain (load cell task)
+    -> torque -> run cycle analyzer -> cure analytics (ModeTask, run mode)
+  and a regression check against the output of python/MDR_simulation.py
+  for the same log (python/torque_output.csv):
+    - every conversion: raw value, recorded timestamp and torque
+    - per-cycle amplitude against the script's fixed 1/f buckets
+    - ML, MH, ts2, t50 and t90 against the same cure analytics fed with
+      the script's cycle amplitudes
+  The per-sample cost of the pipeline (driver excluded) is reported.
+
+  usage: replay_pipeline <loadcell_log.csv> <torque_output.csv> [speed]
+*/
+
+#define REF_MAX_SAMPLES     65536
+#define REF_MAX_CYCLES      4096
+#define RUN_FREQ_HZ         1.66f     // MDR_CYCLE_FREQ_HZ
+
+// Tolerances of the regression check
+#define TOL_TORQUE_NM       1e-4      // ~2 counts: ADC_zero is held as a float on the device
+#define TOL_TIMESTAMP_US    1
+#define TOL_AMP_MEDIAN      0.01      // relative, over cycles with the die oscillating
+#define TOL_AMP_P95         0.05
+#define TOL_LEVEL_NM        0.05      // ML, MH
+#define TOL_TIME_S          3.0f      // ts2, t50, t90 (about two cycles)
+
+/* Private types */
+typedef struct {
+    double t_s;                   // from the first row
+    int32_t raw;
+    double adc_corr;
+    double torque;
+} ref_sample_t;
+
+typedef struct {
+    double t_s;                   // bucket start, from the first sample
+    double amp;
+} ref_cycle_t;
+
+typedef struct {
+    ref_sample_t *sample;
+    uint32_t samples;
+    ref_cycle_t *cycle;
+    uint32_t cycles;
+} ref_t;
+
+/* Private function prototypes */
+static int ref_load(const char *path, ref_t *ref);
+static int parse_time(const char *text, double *t_s);
+static int64_t now_ns(void);
+static int cmp_double(const void *a, const void *b);
+static void check(int ok, const char *what, double got, double want, double tol);
+static void check_time(const char *what, float got, float want);
+
+/**
+  * @brief  Torque from a raw conversion, as mdr_torque() in comm_exec.c
+  */
+static float mdr_torque(int32_t raw, float adc_zero, float k_t)
+{
+    return (k_t > 0.0f) ? (float)((double)raw - (double)adc_zero) * k_t : 0.0f;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <loadcell_log.csv> <torque_output.csv> [speed]\n", argv[0]);
+        return 2;
+    }
+    float speed = (argc > 3) ? (float)atof(argv[3]) : 0.0f;
+
+    ref_t ref;
+    if (ref_load(argv[2], &ref) != 0 || ref.samples < 2) {
+        fprintf(stderr, "cannot read reference %s\n", argv[2]);
+        return 2;
+    }
+
+    /* Calibration the reference was produced with (offset_mdr / calibrate_mdr on the device) */
+    uint32_t big = 0;
+    for (uint32_t i = 1; i < ref.samples; i++) {
+        if (fabs(ref.sample[i].adc_corr) > fabs(ref.sample[big].adc_corr)) {
+            big = i;
+        }
+    }
+    const float adc_zero = (float)((double)ref.sample[0].raw - ref.sample[0].adc_corr);
+    const float k_t = (float)(ref.sample[big].torque / ref.sample[big].adc_corr);
+    printf("calibration: ADC_zero=%.3f K_T=%.9f\n", adc_zero, k_t);
+
+    /* Load cell task and run-mode state, configured as on the device */
+    hx711_t hx;
+    memset(&hx, 0, sizeof(hx));
+    hx711_init(&hx, 0, 0);
+    if (hx711_replay_open(&hx, argv[1], speed) != 0) {
+        fprintf(stderr, "cannot replay %s\n", argv[1]);
+        return 2;
+    }
+    filter_chain_t raw_filter;
+    const filter_spec_t raw_spec = { .type = FILTER_MA, .window = 10 };
+    filter_chain_init(&raw_filter, &raw_spec, 1);
+    filter_chain_set_integer(&raw_filter);
+
+    // run_cfg in CommTask_Init; no die index on the host, so the tracked cycle is the reference
+    static cycle_analyzer_t ca;
+    const cycle_analyzer_config_t run_cfg = {
+        .nominal_hz = RUN_FREQ_HZ, .window_cycles = 1,
+        .smoothing = { .type = FILTER_MA, .window = 5 },
+        .quadrature = 1, .ref = NULL,
+    };
+    cycle_analyzer_init(&ca, &run_cfg);
+    static cure_run_t run;
+    cure_run_start(&run, 0.0f, 60.0f);
+
+    /* Replay */
+    static double amp_err[REF_MAX_CYCLES];
+    uint32_t n = 0, windows = 0, compared = 0, fits = 0;
+    double err_torque = 0.0, ts_err = 0.0;
+    int64_t t0_us = -1, cost_ns = 0, cost_max_ns = 0;
+    cure_fit_result_t fr = {0};
+    hx711_sample_t s;
+    while (!hx711_replay_done(&hx)) {
+        if (!hx711_read_sample(&hx, &s, 1000)) {
+            continue;
+        }
+        if (n >= ref.samples) {
+            n++;
+            continue;
+        }
+        const ref_sample_t *r = &ref.sample[n++];
+        if (t0_us < 0) {
+            t0_us = s.timestamp_us;
+        }
+        if (s.value != r->raw) {
+            printf("sample %u: raw %ld, reference %ld\n", (unsigned)n - 1, (long)s.value, (long)r->raw);
+            check_failures++;
+        }
+        ts_err = fmax(ts_err, fabs((double)(s.timestamp_us - t0_us) - floor(r->t_s * 1e6 + 0.5)));
+
+        int64_t c0 = now_ns();
+        (void)filter_chain_apply(&raw_filter, (double)s.value);
+        float torque = mdr_torque(s.value, adc_zero, k_t);
+        cycle_window_t w;
+        uint8_t window_done = cycle_analyzer_feed(&ca, s.timestamp_us, (double)torque, &w);
+        float t_s = 0.0f;
+        uint8_t fit_ok = 0;
+        if (window_done) {
+            t_s = (float)((double)(w.start_us + w.period_us / 2 - t0_us) / 1e6);
+            fit_ok = cure_run_add(&run, t_s, w.amp_filtered, &fr);
+        }
+        int64_t c = now_ns() - c0;
+        cost_ns += c;
+        if (c > cost_max_ns) {
+            cost_max_ns = c;
+        }
+
+        err_torque = fmax(err_torque, fabs((double)torque - r->torque));
+        if (!window_done) {
+            continue;
+        }
+        windows++;
+        fits += fit_ok;
+        // Reference bucket holding the middle of this cycle
+        double period = 1.0 / RUN_FREQ_HZ;
+        uint32_t k = (uint32_t)floor((double)t_s / period);
+        if (w.locked && k < ref.cycles && ref.cycle[k].amp > 0.5 && compared < REF_MAX_CYCLES) {
+            amp_err[compared++] = fabs(w.amp - ref.cycle[k].amp) / ref.cycle[k].amp;
+        }
+    }
+    hx711_replay_close(&hx);
+
+    printf("replayed %u conversions, %u cycle windows, %u fits; max torque error %.2e N.m, max timestamp error %.0f us\n",
+           (unsigned)n, (unsigned)windows, (unsigned)fits, err_torque, ts_err);
+    check(n == ref.samples, "conversions", n, ref.samples, 0.0);
+    check(ts_err <= TOL_TIMESTAMP_US, "max timestamp error (us)", ts_err, 0.0, TOL_TIMESTAMP_US);
+    check(err_torque <= TOL_TORQUE_NM, "max torque error (N.m)", err_torque, 0.0, TOL_TORQUE_NM);
+
+    /* Cycle amplitudes: crossing-locked cycles against fixed buckets, so compare the distribution */
+    if (compared > 0) {
+        qsort(amp_err, compared, sizeof(amp_err[0]), cmp_double);
+        double med = amp_err[compared / 2];
+        double p95 = amp_err[(uint32_t)(0.95 * (compared - 1))];
+        printf("cycle amplitude vs reference: %u cycles, median %.2f %%, p95 %.2f %%, max %.2f %%\n",
+               (unsigned)compared, med * 100.0, p95 * 100.0, amp_err[compared - 1] * 100.0);
+        check(med <= TOL_AMP_MEDIAN, "median cycle amplitude error", med, 0.0, TOL_AMP_MEDIAN);
+        check(p95 <= TOL_AMP_P95, "p95 cycle amplitude error", p95, 0.0, TOL_AMP_P95);
+    }
+    check(compared * 10 >= ref.cycles * 8, "cycles compared", compared, ref.cycles, ref.cycles * 0.2);
+
+    /* Cure analytics: the same stack fed with the reference cycle amplitudes */
+    static cure_run_t ref_run;
+    filter_chain_t ref_smooth;
+    cure_fit_result_t ref_fr = {0};
+    filter_chain_init(&ref_smooth, &run_cfg.smoothing, 1);
+    cure_run_start(&ref_run, 0.0f, 60.0f);
+    for (uint32_t k = 0; k < ref.cycles; k++) {
+        double amp = filter_chain_apply(&ref_smooth, ref.cycle[k].amp);
+        (void)cure_run_add(&ref_run, (float)(ref.cycle[k].t_s + 0.5 / RUN_FREQ_HZ), amp, &ref_fr);
+    }
+    cure_result_t cr, rr;
+    cure_curve_result(&run.curve, &cr);
+    cure_curve_result(&ref_run.curve, &rr);
+    printf("cure: ML %.3f MH %.3f ts2 %.1f t50 %.1f t90 %.1f (reference ML %.3f MH %.3f ts2 %.1f t50 %.1f t90 %.1f)\n",
+           cr.ml, cr.mh, cr.ts2, cr.t50, cr.t90, rr.ml, rr.mh, rr.ts2, rr.t50, rr.t90);
+    check(fabs(cr.ml - rr.ml) <= TOL_LEVEL_NM, "ML", cr.ml, rr.ml, TOL_LEVEL_NM);
+    check(fabs(cr.mh - rr.mh) <= TOL_LEVEL_NM, "MH", cr.mh, rr.mh, TOL_LEVEL_NM);
+    check_time("ts2", cr.ts2, rr.ts2);
+    check_time("t50", cr.t50, rr.t50);
+    check_time("t90", cr.t90, rr.t90);
+    if (fits > 0) {
+        printf("fit: MH %.3f [%.3f, %.3f] t90 %.1f [%.1f, %.1f] (reference MH %.3f t90 %.1f)\n",
+               fr.mh, fr.mh_ci_lo, fr.mh_ci_hi, fr.t90, fr.t90_ci_lo, fr.t90_ci_hi, ref_fr.mh, ref_fr.t90);
+    }
+
+    printf("pipeline cost: %.0f ns/conversion mean, %.0f ns max (driver and file I/O excluded)\n",
+           n ? (double)cost_ns / n : 0.0, (double)cost_max_ns);
+
+    free(ref.sample);
+    free(ref.cycle);
+    return check_done("replay_pipeline");
+}
+
+/* torque_output.csv: per-conversion rows, a blank line, then per-cycle rows */
+static int ref_load(const char *path, ref_t *ref)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL) {
+        return -1;
+    }
+    memset(ref, 0, sizeof(*ref));
+    ref->sample = calloc(REF_MAX_SAMPLES, sizeof(*ref->sample));
+    ref->cycle = calloc(REF_MAX_CYCLES, sizeof(*ref->cycle));
+    char line[160], ts[40];
+    double t0 = 0.0;
+    uint8_t cycles = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        double t, a, b, c;
+        long raw;
+        if (strncmp(line, "cycle_start_iso", 15) == 0) {
+            cycles = 1;
+        } else if (!cycles && sscanf(line, "%39[^,],%ld,%lf,%lf", ts, &raw, &a, &b) == 4 &&
+                   parse_time(ts, &t) == 0 && ref->samples < REF_MAX_SAMPLES) {
+            if (ref->samples == 0) {
+                t0 = t;
+            }
+            ref->sample[ref->samples++] = (ref_sample_t){ .t_s = t - t0, .raw = (int32_t)raw, .adc_corr = a, .torque = b };
+        } else if (cycles && sscanf(line, "%39[^,],%lf,%lf", ts, &a, &c) == 3 &&
+                   parse_time(ts, &t) == 0 && ref->cycles < REF_MAX_CYCLES) {
+            ref->cycle[ref->cycles++] = (ref_cycle_t){ .t_s = t - t0, .amp = a };
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+/* ISO 8601 local time to seconds (days counted from 1970-01-01) */
+static int parse_time(const char *text, double *t_s)
+{
+    int y, mo, d, h, mi;
+    double sec;
+    if (sscanf(text, "%d-%d-%dT%d:%d:%lf", &y, &mo, &d, &h, &mi, &sec) != 6) {
+        return -1;
+    }
+    y -= mo <= 2;
+    long era = (y >= 0 ? y : y - 399) / 400;
+    long yoe = y - era * 400;
+    long doy = (153 * (mo + (mo > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    long days = era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+    *t_s = (double)((days * 24 + h) * 60 + mi) * 60.0 + sec;
+    return 0;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void check(int ok, const char *what, double got, double want, double tol)
+{
+    if (!ok) {
+        printf("FAIL %s: %.6g, expected %.6g (tolerance %.3g)\n", what, got, want, tol);
+        check_failures++;
+    }
+}
+
+/* Cure times: both reached and within TOL_TIME_S, or both not reached */
+static void check_time(const char *what, float got, float want)
+{
+    int ok = (got < 0.0f && want < 0.0f) || (got >= 0.0f && want >= 0.0f && fabsf(got - want) <= TOL_TIME_S);
+    check(ok, what, got, want, TOL_TIME_S);
+}
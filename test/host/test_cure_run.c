@@ -0,0 +1,146 @@
+#include "cure_run.h"
+#include "check.h"
+#include <math.h>
+
+/*
+  Run-mode cure analytics on a synthetic cure curve: a flat induction
+  period at ML (optionally with a dip before ML), then a first-order rise
+  to MH with t90 at CURVE_T90 s.
+*/
+
+#define CURVE_ML        1.0
+#define CURVE_MH        5.0
+#define CURVE_TI        60.0          // end of the induction period (s)
+#define CURVE_T90       290.0
+#define CYCLE_S         (1.0 / 1.66)
+
+static uint32_t noise_state;
+
+static double curve_k(void)
+{
+    return log(10.0) / (CURVE_T90 - CURVE_TI);
+}
+
+/* Uniform in [-0.005, 0.005) N·m, repeatable */
+static double noise(void)
+{
+    noise_state = noise_state * 1664525u + 1013904223u;
+    return ((double)(noise_state >> 8) / 16777216.0 - 0.5) * 0.01;
+}
+
+static double curve(double t, int dip)
+{
+    if (dip && t < 30.0) {
+        return CURVE_ML + 0.3 * (1.0 - t / 30.0);
+    }
+    if (t < CURVE_TI) {
+        return CURVE_ML;
+    }
+    return CURVE_ML + (CURVE_MH - CURVE_ML) * (1.0 - exp(-curve_k() * (t - CURVE_TI)));
+}
+
+/* Feed cycles until the plateau ends the run or t_max; returns the last cycle time */
+static float run_curve(cure_run_t *run, float slope, float window_s, int dip, float t_max)
+{
+    cure_fit_result_t fit;
+    cure_run_start(run, slope, window_s);
+    float t = 0.0f;
+    for (uint32_t i = 0; run->end_s < 0.0f; i++) {
+        t = (float)((i + 0.5) * CYCLE_S);
+        if (t > t_max) {
+            break;
+        }
+        (void)cure_run_add(run, t, curve(t, dip), &fit);
+    }
+    return t;
+}
+
+/* The plateau only counts after scorch, over a full window, and the curve is really flat there */
+static void test_plateau_after_scorch(void)
+{
+    static cure_run_t run;
+    const float slopes[] = { 0.05f, 0.2f, 0.8f };
+    const float window_s = 60.0f;
+    for (int dip = 0; dip < 2; dip++) {
+        for (unsigned i = 0; i < sizeof(slopes) / sizeof(slopes[0]); i++) {
+            (void)run_curve(&run, slopes[i], window_s, dip, 1200.0f);
+            cure_result_t cr;
+            cure_curve_result(&run.curve, &cr);
+            CHECK(run.end_s > 0.0f);
+            CHECK(cr.ts2 > 0.0f);
+            CHECK(run.end_s - cr.ts2 >= 0.9f * window_s);
+            double slope_end = curve_k() * (CURVE_MH - curve(run.end_s, dip)) * 60.0;
+            CHECK(slope_end < slopes[i]);
+        }
+    }
+
+    // Off: the run goes the full time
+    float t = run_curve(&run, 0.0f, window_s, 0, 600.0f);
+    CHECK(run.end_s < 0.0f);
+    CHECK(t > 599.0f);
+}
+
+/* Once the curve is past the level, t90 is the crossing and does not move with the clock */
+static void test_t90_after_crossing(void)
+{
+    static cure_run_t run;
+    cure_fit_result_t fit;
+    float t90_at_400 = -1.0f;
+    noise_state = 1;
+    cure_run_start(&run, 0.0f, 60.0f);
+    for (uint32_t i = 0; ; i++) {
+        float t = (float)((i + 0.5) * CYCLE_S);
+        if (t > 600.0f) {
+            break;
+        }
+        uint8_t ok = cure_run_add(&run, t, curve(t, 0) + noise(), &fit);
+        if (t90_at_400 < 0.0f && t >= 400.0f) {
+            CHECK(ok);
+            t90_at_400 = fit.t90;
+        }
+    }
+    CHECK(fabsf(fit.t90 - (float)CURVE_T90) < 5.0f);
+    CHECK(fabsf(fit.t90 - t90_at_400) < 2.0f);
+    CHECK(fit.t90_ci_lo < fit.t90 && fit.t90 < fit.t90_ci_hi);
+    CHECK(fit.t90_ci_hi < 600.0f);
+    CHECK(fit.mh_ci_lo < CURVE_MH && CURVE_MH < fit.mh_ci_hi);
+}
+
+/* Smoothed (MA5) noise as the cycle analyzer gives it: the MH bounds still cover the true MH */
+static void test_mh_coverage(void)
+{
+    static cure_run_t run;
+    const int trials = 100;
+    int fits = 0, covered = 0;
+    for (int tr = 0; tr < trials; tr++) {
+        double ma[5] = { 0 };
+        cure_fit_result_t fit;
+        uint8_t ok = 0;
+        noise_state = (uint32_t)tr * 7919u + 1u;
+        cure_run_start(&run, 0.0f, 60.0f);
+        for (uint32_t i = 0; ; i++) {
+            float t = (float)((i + 0.5) * CYCLE_S);
+            if (t > 200.0f) {
+                break;
+            }
+            ma[i % 5] = 4.0 * noise();
+            double nz = (ma[0] + ma[1] + ma[2] + ma[3] + ma[4]) / 5.0;
+            ok = cure_run_add(&run, t, curve(t, 0) + nz, &fit);
+        }
+        if (ok) {
+            fits++;
+            covered += (fit.mh_ci_lo <= CURVE_MH && CURVE_MH <= fit.mh_ci_hi);
+            CHECK(fit.rho > 0.0);
+        }
+    }
+    CHECK(fits == trials);
+    CHECK(covered >= 90 * fits / 100);
+}
+
+int main(void)
+{
+    test_plateau_after_scorch();
+    test_t90_after_crossing();
+    test_mh_coverage();
+    return check_done("cure_run");
+}
@@ -0,0 +1,106 @@
+#include "filter_chain.h"
+#include "check.h"
+#include <math.h>
+#include <string.h>
+
+/*
+  Filter chain: moving averages exact (integer input) or compensated over
+  long runs without re-summing, window limits, and a reconfiguration that
+  restarts the history once.
+*/
+
+static uint32_t lcg_state = 1;
+
+static uint32_t lcg(void)
+{
+    lcg_state = lcg_state * 1664525u + 1013904223u;
+    return lcg_state;
+}
+
+/* Reference mean of the last w values of v[0..i] */
+static double window_mean(const double *v, uint32_t i, uint16_t w)
+{
+    uint32_t n = (i + 1 < w) ? i + 1 : w;
+    long double s = 0.0L;
+    for (uint32_t k = 0; k < n; k++) {
+        s += v[i - k];
+    }
+    return (double)(s / n);
+}
+
+static void test_ma_integer(void)
+{
+    static filter_chain_t chain;
+    static double v[200000];
+    const filter_spec_t spec = { .type = FILTER_MA, .window = 10 };
+    filter_chain_init(&chain, &spec, 1);
+    filter_chain_set_integer(&chain);
+    double err = 0.0;
+    for (uint32_t i = 0; i < sizeof(v) / sizeof(v[0]); i++) {
+        // 24-bit conversions around a large offset, as the HX711 gives them
+        v[i] = (double)(int32_t)(8000000 + (lcg() >> 12) - 500000);
+        double y = filter_chain_apply(&chain, v[i]);
+        err = fmax(err, fabs(y - window_mean(v, i, 10)));
+    }
+    CHECK(err == 0.0);
+}
+
+static void test_ma_double(void)
+{
+    static filter_chain_t chain;
+    static double v[200000];
+    const filter_spec_t spec = { .type = FILTER_MA, .window = FILTER_POOL_SAMPLES };
+    filter_chain_init(&chain, &spec, 1);
+    CHECK(chain.stages == 1);
+    double err = 0.0;
+    for (uint32_t i = 0; i < sizeof(v) / sizeof(v[0]); i++) {
+        // Large mean, small fractional variation: the case a plain running sum drifts on
+        v[i] = 1e6 + (double)(lcg() >> 8) / 16777216.0 * 1e-3;
+        double y = filter_chain_apply(&chain, v[i]);
+        if (i % 97 == 0 || i + 1 == sizeof(v) / sizeof(v[0])) {
+            err = fmax(err, fabs(y - window_mean(v, i, FILTER_POOL_SAMPLES)));
+        }
+    }
+    CHECK(err < 1e-9);
+}
+
+static void test_limits(void)
+{
+    filter_spec_t spec[FILTER_MAX_STAGES];
+    char text[FILTER_SPEC_LEN];
+    CHECK(filter_spec_parse("ma:256", spec, FILTER_MAX_STAGES) == 1);
+    CHECK(filter_spec_parse("ma:257", spec, FILTER_MAX_STAGES) == -1);
+    CHECK(filter_spec_parse("hampel:64:3,ma:192", spec, FILTER_MAX_STAGES) == 2);
+    CHECK(filter_spec_parse("hampel:64:3,ma:193", spec, FILTER_MAX_STAGES) == -1);
+    CHECK(filter_spec_parse("median:65", spec, FILTER_MAX_STAGES) == -1);
+    CHECK(filter_spec_parse("iir:0.5,iir:0.5,iir:0.5,iir:0.5,iir:0.5", spec, FILTER_MAX_STAGES) == -1);
+    CHECK(filter_spec_parse("median:5,ma:100,iir:0.2", spec, FILTER_MAX_STAGES) == 3);
+    filter_spec_format(spec, 3, text, sizeof(text));
+    CHECK(strcmp(text, "median:5,ma:100,iir:0.2") == 0);
+}
+
+static void test_request(void)
+{
+    static filter_chain_t chain;
+    const filter_spec_t spec = { .type = FILTER_MA, .window = 4 };
+    filter_chain_init(&chain, &spec, 1);
+    for (int i = 0; i < 8; i++) {
+        (void)filter_chain_apply(&chain, 100.0);
+    }
+    CHECK(filter_chain_request(&chain, "hampel:5:3,ma:3") == 2);
+    CHECK(filter_chain_request(&chain, "ma:300") == -1);
+    // The new stages start empty: 100s from before the request do not leak in
+    CHECK(filter_chain_apply(&chain, 10.0) == 10.0);
+    CHECK(filter_chain_apply(&chain, 20.0) == 15.0);
+    CHECK(chain.stages == 2);
+    CHECK(chain.stage[1].offset == 5);
+}
+
+int main(void)
+{
+    test_ma_integer();
+    test_ma_double();
+    test_limits();
+    test_request();
+    return check_done("filter_chain");
+}
@@ -0,0 +1,194 @@
+#include "hx711.h"
+#include "hx711_port.h"
+#include "check.h"
+#include <string.h>
+#include <time.h>
+
+/*
+  hx711.c against the mock backend: PD_SCK pulse counts per channel/gain,
+  the settling conversion after a switch, read timeouts and the
+  asynchronous average/tare/weight requests.
+*/
+
+typedef struct {
+    uint8_t calls;
+    hx711_req_t req;
+    int32_t average;
+    float weight;
+} done_t;
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static int32_t decoded(int32_t raw)
+{
+    // hx711.c returns offset binary: 24-bit two's complement with the sign bit flipped
+    return (int32_t)(((uint32_t)raw & 0xFFFFFF) ^ 0x800000);
+}
+
+static void setup(hx711_t *hx)
+{
+    memset(hx, 0, sizeof(*hx));
+    // hx711_init() reads and discards two conversions
+    hx711_mock_push(hx, 0);
+    hx711_mock_push(hx, 0);
+    hx711_init(hx, 0, 0);
+    hx711_coef_set(hx, 1.0f);
+}
+
+static void on_done(hx711_t *hx711, hx711_req_t req, int32_t average, float weight, void *arg)
+{
+    (void)hx711;
+    done_t *done = (done_t *)arg;
+    done->calls++;
+    done->req = req;
+    done->average = average;
+    done->weight = weight;
+}
+
+static void test_gain_pulses(void)
+{
+    hx711_t hx;
+    hx711_sample_t s;
+    setup(&hx);
+    CHECK(hx711_mock_pulses(&hx) == 25);
+
+    const hx711_gain_t gains[] = { HX711_GAIN_B_32, HX711_GAIN_A_64, HX711_GAIN_A_128 };
+    for (uint8_t i = 0; i < sizeof(gains) / sizeof(gains[0]); i++) {
+        hx711_set_gain(&hx, gains[i]);
+        CHECK(hx711_get_gain(&hx) == gains[i]);
+        hx711_mock_push(&hx, 1000 + i);
+        CHECK(hx711_read_sample(&hx, &s, 100));
+        CHECK(hx711_mock_pulses(&hx) == (uint8_t)gains[i]);
+        CHECK(s.value == decoded(1000 + i));
+    }
+}
+
+static void test_settling(void)
+{
+    hx711_t hx;
+    hx711_sample_t s;
+    setup(&hx);
+    for (int32_t i = 0; i < 4; i++) {
+        hx711_mock_push(&hx, -100 * i);
+    }
+
+    // Switch while A/128 is converting: that conversion is still A/128, clean
+    hx711_set_gain(&hx, HX711_GAIN_B_32);
+    CHECK(hx711_read_sample(&hx, &s, 100));
+    CHECK(s.gain == HX711_GAIN_A_128);
+    CHECK(!s.settling);
+    CHECK(s.value == decoded(0));
+
+    // First B/32 conversion is flagged for discard, the next ones are not
+    CHECK(hx711_read_sample(&hx, &s, 100));
+    CHECK(s.gain == HX711_GAIN_B_32);
+    CHECK(s.settling);
+    CHECK(hx711_settling(&hx) == 0);
+    CHECK(hx711_read_sample(&hx, &s, 100));
+    CHECK(s.gain == HX711_GAIN_B_32);
+    CHECK(!s.settling);
+    CHECK(s.value == decoded(-200));
+
+    // Re-selecting the current gain does not start another settling period
+    hx711_set_gain(&hx, HX711_GAIN_B_32);
+    CHECK(hx711_read_sample(&hx, &s, 100));
+    CHECK(!s.settling);
+    CHECK(s.seq == 4);
+}
+
+static void test_timeout(void)
+{
+    hx711_t hx;
+    hx711_sample_t s;
+    setup(&hx);
+
+    int64_t t0 = now_us();
+    CHECK(hx711_read_sample(&hx, &s, 20) == 0);
+    int64_t elapsed = now_us() - t0;
+    CHECK(elapsed >= 20000);
+    CHECK(elapsed < 500000);
+    CHECK(hx.seq == 0);
+    CHECK(hx.latency.count == 0);
+
+    // Powered down (PD_SCK high): busy even with conversions queued
+    hx711_mock_push(&hx, 1);
+    hx711_power_down(&hx);
+    CHECK(hx711_read_sample(&hx, &s, 10) == 0);
+    hx711_power_up(&hx);
+    CHECK(hx711_read_sample(&hx, &s, 10) == 1);
+    CHECK(s.seq == 1);
+}
+
+static void test_requests(void)
+{
+    hx711_t hx;
+    hx711_sample_t s;
+    done_t done;
+    setup(&hx);
+
+    CHECK(hx711_request(&hx, HX711_GAIN_A_128, HX711_REQ_NONE, 4, on_done, &done) == 0);
+    CHECK(hx711_request(&hx, HX711_GAIN_A_128, HX711_REQ_TARE, 0, on_done, &done) == 0);
+
+    // Tare: mean of the next conversions on the requested gain becomes the offset
+    memset(&done, 0, sizeof(done));
+    CHECK(hx711_request(&hx, HX711_GAIN_A_128, HX711_REQ_TARE, 3, on_done, &done));
+    CHECK(hx711_request_pending(&hx));
+    CHECK(hx711_request(&hx, HX711_GAIN_A_128, HX711_REQ_AVERAGE, 1, on_done, &done) == 0);
+    hx711_mock_push(&hx, 10);
+    hx711_mock_push(&hx, 20);
+    hx711_mock_push(&hx, 30);
+    for (uint8_t i = 0; i < 3; i++) {
+        CHECK(hx711_read_sample(&hx, &s, 100));
+    }
+    CHECK(done.calls == 1);
+    CHECK(done.req == HX711_REQ_TARE);
+    CHECK(done.average == decoded(20));
+    CHECK(hx.offset == decoded(20));
+    CHECK(!hx711_request_pending(&hx));
+
+    // Weight: (mean - offset) / coef
+    memset(&done, 0, sizeof(done));
+    hx711_coef_set(&hx, 4.0f);
+    CHECK(hx711_request(&hx, HX711_GAIN_A_128, HX711_REQ_WEIGHT, 2, on_done, &done));
+    hx711_mock_push(&hx, 60);
+    hx711_mock_push(&hx, 80);
+    CHECK(hx711_read_sample(&hx, &s, 100));
+    CHECK(done.calls == 0);
+    CHECK(hx711_read_sample(&hx, &s, 100));
+    CHECK(done.calls == 1);
+    CHECK(done.req == HX711_REQ_WEIGHT);
+    CHECK(done.weight == 12.5f);
+    CHECK(hx.offset == decoded(20));
+
+    // Average on B/32: other-gain and settling conversions are skipped
+    memset(&done, 0, sizeof(done));
+    CHECK(hx711_request(&hx, HX711_GAIN_B_32, HX711_REQ_AVERAGE, 2, on_done, &done));
+    hx711_set_gain(&hx, HX711_GAIN_B_32);
+    hx711_mock_push(&hx, 5000);    // A/128, selects B/32
+    hx711_mock_push(&hx, 7000);    // B/32, settling
+    hx711_mock_push(&hx, -300);
+    hx711_mock_push(&hx, -100);
+    for (uint8_t i = 0; i < 3; i++) {
+        CHECK(hx711_read_sample(&hx, &s, 100));
+    }
+    CHECK(done.calls == 0);
+    CHECK(hx711_read_sample(&hx, &s, 100));
+    CHECK(done.calls == 1);
+    CHECK(done.req == HX711_REQ_AVERAGE);
+    CHECK(done.average == decoded(-200));
+    CHECK(hx.offset == decoded(20));
+}
+
+int main(void)
+{
+    test_gain_pulses();
+    test_settling();
+    test_timeout();
+    test_requests();
+    return check_done("hx711_mock");
+}
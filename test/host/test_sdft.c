@@ -0,0 +1,69 @@
+#include "sdft.h"
+#include "check.h"
+#include <math.h>
+
+/*
+  Sliding DFT: amplitude of a sine, and a retune to a new period that keeps
+  the amplitude available instead of restarting the window.
+*/
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#define AMP     2.0
+
+static double sine(uint32_t i, uint16_t period)
+{
+    return 0.5 + AMP * sin(2.0 * M_PI * (double)i / (double)period);
+}
+
+static void test_amplitude(void)
+{
+    static sdft_t sd;
+    CHECK(sdft_init(&sd, 48));
+    for (uint32_t i = 0; i < 47; i++) {
+        CHECK(sdft_update(&sd, sine(i, 48)) == 0.0);
+    }
+    for (uint32_t i = 47; i < 48 * 100; i++) {
+        double a = sdft_update(&sd, sine(i, 48));
+        CHECK(fabs(a - AMP) < 1e-5);
+    }
+    CHECK(!sdft_init(&sd, 1));
+    CHECK(!sdft_init(&sd, SDFT_MAX_WINDOW + 1));
+    CHECK(sd.n == 48);
+}
+
+/* Period 48 -> 52 and 52 -> 46: no gap in the amplitude, exact again after one new period */
+static void test_retune(void)
+{
+    static sdft_t sd;
+    const uint16_t periods[] = { 48, 52, 46 };
+    uint32_t i = 0;
+    CHECK(sdft_init(&sd, periods[0]));
+    for (; i < 3 * periods[0]; i++) {
+        (void)sdft_update(&sd, sine(i, periods[0]));
+    }
+    for (unsigned p = 1; p < sizeof(periods) / sizeof(periods[0]); p++) {
+        const uint16_t n = periods[p];
+        CHECK(sdft_retune(&sd, n));
+        CHECK(sd.n == n);
+        CHECK(fabs(sdft_amplitude(&sd) - AMP) < 0.1 * AMP);
+        for (uint32_t k = 0; k < 3u * n; k++, i++) {
+            double a = sdft_update(&sd, sine(k, n));
+            CHECK(a > 0.5 * AMP);
+            if (k >= n) {
+                CHECK(fabs(a - AMP) < 1e-5);
+            }
+        }
+    }
+    CHECK(!sdft_retune(&sd, SDFT_MAX_WINDOW + 1));
+    CHECK(sd.n == periods[2]);
+}
+
+int main(void)
+{
+    test_amplitude();
+    test_retune();
+    return check_done("sdft");
+}
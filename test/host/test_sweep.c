@@ -0,0 +1,80 @@
+#include "sweep.h"
+#include "check.h"
+#include <math.h>
+#include <string.h>
+
+/*
+  Sweep averaging: settling part of the dwell discarded, phase results only
+  from windows referenced to the die index, and the frequency range the
+  lock-in can follow at a given conversion rate.
+*/
+
+static cycle_window_t window(double s_prime, double s_dprime, uint8_t ref)
+{
+    cycle_window_t w;
+    memset(&w, 0, sizeof(w));
+    w.locked = 1;
+    w.cycles = 1;
+    w.freq_hz = 1.0;
+    w.has_quad = 1;
+    w.quad_ref = ref;
+    w.quad.s_prime = s_prime;
+    w.quad.s_dprime = s_dprime;
+    w.quad.amp = hypot(s_prime, s_dprime);
+    return w;
+}
+
+/* One cycle per second for a 10 s dwell; every window can be index referenced or not */
+static const sweep_point_t *run_step(sweep_t *sw, uint8_t ref)
+{
+    const sweep_step_t step = { .freq_hz = 1.0f, .dwell_s = 10.0f };
+    sweep_start(sw, &step, 1, 0.0f);
+    for (int i = 0; i < 10; i++) {
+        // Settling windows carry a different value that must not show up
+        cycle_window_t w = (i < 5) ? window(9.0, 9.0, ref) : window(3.0, 4.0, ref);
+        sweep_add(sw, (float)i, &w);
+    }
+    CHECK(sweep_poll(sw, 9.5f) == -1);
+    CHECK(sweep_poll(sw, 10.0f) == 0);
+    CHECK(sweep_done(sw));
+    return &sw->table[0];
+}
+
+static void test_reference(void)
+{
+    static sweep_t sw;
+    const sweep_point_t *p = run_step(&sw, 1);
+    CHECK(p->cycles == 5);
+    CHECK(p->ref_index);
+    CHECK(fabs(p->amp - 5.0) < 1e-9);
+    CHECK(fabs(p->s_prime - 3.0) < 1e-9);
+    CHECK(fabs(p->s_dprime - 4.0) < 1e-9);
+    CHECK(fabs(p->tan_delta - 4.0 / 3.0) < 1e-9);
+
+    // Tracked-cycle reference: amplitude only
+    p = run_step(&sw, 0);
+    CHECK(p->cycles == 5);
+    CHECK(!p->ref_index);
+    CHECK(fabs(p->amp - 5.0) < 1e-9);
+    CHECK(p->phase_deg == 0.0 && p->s_prime == 0.0 && p->s_dprime == 0.0 && p->tan_delta == 0.0);
+}
+
+static void test_freq_range(void)
+{
+    float lo, hi;
+    sweep_freq_range(0.0, &lo, &hi);
+    CHECK(lo == SWEEP_MIN_HZ && hi == SWEEP_MAX_HZ);
+    sweep_freq_range(80.0, &lo, &hi);
+    CHECK(lo == SWEEP_MIN_HZ && hi == SWEEP_MAX_HZ);
+    sweep_freq_range(10.0, &lo, &hi);
+    CHECK(lo == SWEEP_MIN_HZ && fabsf(hi - 1.25f) < 1e-6f);
+    sweep_freq_range(320.0, &lo, &hi);
+    CHECK(fabsf(lo - 2.0f) < 1e-6f && hi == SWEEP_MAX_HZ);
+}
+
+int main(void)
+{
+    test_reference();
+    test_freq_range();
+    return check_done("sweep");
+}
@@ -0,0 +1,115 @@
+#include "tx_ring.h"
+#include "check.h"
+#include <string.h>
+
+/*
+  Output record ring, single task: order, the filler record at the wrap,
+  both overflow policies and the copy bounds of the reader.
+*/
+
+#define RING_SIZE   4096
+
+static uint8_t buf[RING_SIZE + 64] __attribute__((aligned(4)));
+static uint32_t stamp[RING_SIZE / TX_RING_ALIGN];
+
+static void fill(uint8_t *rec, size_t len, uint8_t tag)
+{
+    for (size_t i = 0; i < len; i++) {
+        rec[i] = (uint8_t)(tag + i);
+    }
+}
+
+static uint8_t matches(const uint8_t *rec, size_t len, uint8_t tag)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (rec[i] != (uint8_t)(tag + i)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Records of varying length through many wraps come out whole and in order */
+static void test_order_and_wrap(void)
+{
+    static tx_ring_t ring;
+    uint8_t rec[TX_RING_MAX_RECORD], out[TX_RING_MAX_RECORD];
+    tx_ring_init(&ring, buf, stamp, RING_SIZE, TX_DROP_NEWEST);
+    uint8_t tag_in = 0, tag_out = 0;
+    for (int round = 0; round < 200; round++) {
+        for (int k = 0; k < 3; k++) {
+            size_t len = 1 + (size_t)((round * 37 + k * 101) % 700);
+            fill(rec, len, tag_in);
+            CHECK(tx_ring_write(&ring, rec, len));
+            tag_in++;
+        }
+        for (int k = 0; k < 3; k++) {
+            size_t n = tx_ring_read(&ring, out, sizeof(out));
+            CHECK(n == 1 + (size_t)((round * 37 + k * 101) % 700));
+            CHECK(matches(out, n, tag_out));
+            tag_out++;
+        }
+    }
+    CHECK(tx_ring_read(&ring, out, sizeof(out)) == 0);
+    CHECK(tx_ring_used(&ring) == 0);
+}
+
+static void test_overflow(void)
+{
+    static tx_ring_t ring;
+    uint8_t rec[TX_RING_MAX_RECORD], out[TX_RING_MAX_RECORD];
+    tx_ring_stats_t st;
+
+    // Drop newest: the queued records survive, the new one is refused
+    tx_ring_init(&ring, buf, stamp, RING_SIZE, TX_DROP_NEWEST);
+    int queued = 0;
+    for (uint8_t i = 0; i < 10; i++) {
+        fill(rec, 1000, i);
+        queued += tx_ring_write(&ring, rec, 1000);
+    }
+    tx_ring_get_stats(&ring, &st);
+    CHECK(queued == 4);
+    CHECK(st.dropped_newest == 6);
+    CHECK(tx_ring_read(&ring, out, sizeof(out)) == 1000 && matches(out, 1000, 0));
+
+    // Drop oldest: the latest records survive
+    tx_ring_init(&ring, buf, stamp, RING_SIZE, TX_DROP_OLDEST);
+    for (uint8_t i = 0; i < 10; i++) {
+        fill(rec, 1000, i);
+        CHECK(tx_ring_write(&ring, rec, 1000));
+    }
+    tx_ring_get_stats(&ring, &st);
+    CHECK(st.dropped_oldest == 6);
+    for (uint8_t i = 6; i < 10; i++) {
+        CHECK(tx_ring_read(&ring, out, sizeof(out)) == 1000 && matches(out, 1000, i));
+    }
+    CHECK(tx_ring_write(&ring, rec, TX_RING_MAX_RECORD + 1) == 0);
+}
+
+/* A header that no longer describes its record (space reused) never copies past the buffer */
+static void test_torn_header(void)
+{
+    static tx_ring_t ring;
+    uint8_t rec[64], out[TX_RING_MAX_RECORD];
+    tx_ring_init(&ring, buf, stamp, RING_SIZE, TX_DROP_NEWEST);
+    memset(&buf[RING_SIZE], 0xA5, 64);
+    // Move to the last slot of the buffer
+    for (int i = 0; i < RING_SIZE / 64 - 1; i++) {
+        CHECK(tx_ring_write(&ring, rec, 60));
+        CHECK(tx_ring_read(&ring, out, sizeof(out)) == 60);
+    }
+    CHECK(tx_ring_write(&ring, rec, 60));
+    const uint16_t torn = 1000;
+    memcpy(&buf[RING_SIZE - 64], &torn, sizeof(torn));
+    memset(out, 0, sizeof(out));
+    (void)tx_ring_read(&ring, out, sizeof(out));
+    CHECK(out[64] == 0 && out[100] == 0);
+}
+
+int main(void)
+{
+    test_order_and_wrap();
+    test_overflow();
+    test_torn_header();
+    return check_done("tx_ring");
+}